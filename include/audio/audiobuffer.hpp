@@ -21,17 +21,66 @@
 #define MANA_AUDIOBUFFER_HPP
 
 #include <vector>
+#include <memory>
 
 #include <cstdint>
+#include <cstddef>
 
 #include "audio/audioformat.hpp"
 
 namespace engine {
+    class Waveform;
+
+    /**
+     * Properties of the buffer contents determined when the data was loaded.
+     */
+    struct AudioMetadata {
+        float onset = 0; // The pre-roll in seconds before the transient onset of the sound
+        float peak = 0; // The largest sample magnitude
+        float loudness = 0; // The short-term loudness in dBFS
+        float gain = 1; // The normalization gain which was applied to the data
+        float duration = 0; // The length of the whole sound in seconds
+        std::shared_ptr<const Waveform> waveform; // The waveform pyramid of the data, null if none was built
+        bool partial = false; // Only a head segment of the sound was loaded
+    };
+
     class AudioBuffer {
     public:
         virtual ~AudioBuffer() = default;
 
-        virtual void upload(const std::vector<uint8_t> &buffer, AudioFormat format, unsigned int frequency) = 0;
+        /**
+         * Replace the contents of the buffer.
+         *
+         * @param data The PCM data in the given format, it is not referenced after the call returns.
+         * @param size The size of data in bytes
+         */
+        virtual void upload(const void *data, size_t size, AudioFormat format, unsigned int frequency) = 0;
+
+        void upload(const std::vector<uint8_t> &buffer, AudioFormat format, unsigned int frequency) {
+            upload(buffer.data(), buffer.size(), format, frequency);
+        }
+
+        /**
+         * Replace a range of the uploaded contents while keeping the format and frequency.
+         *
+         * Sources playing the buffer pick up the change, the metadata is not updated.
+         * The caller passes the complete contents so that implementations which cannot replace a range
+         * upload them whole instead of keeping a copy of every buffer.
+         *
+         * Backends which can only upload whole buffers throw instead of updating a buffer which is attached to a
+         * source, the caller then has to detach the buffer from its sources first.
+         *
+         * @param data The complete PCM data including the change in the format of the last upload,
+         * it is not referenced after the call returns.
+         * @param size The size of data in bytes, equal to the size of the last upload
+         * @param offset The offset in bytes of the changed range, aligned to whole frames
+         * @param length The size of the changed range in bytes, aligned to whole frames
+         */
+        virtual void update(const void *data, size_t size, size_t offset, size_t length) = 0;
+
+        virtual void setMetadata(const AudioMetadata &metadata) = 0;
+
+        virtual const AudioMetadata &getMetadata() const = 0;
     };
 }
 
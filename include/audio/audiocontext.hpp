@@ -21,6 +21,9 @@
 #define MANA_AUDIOCONTEXT_HPP
 
 #include <memory>
+#include <chrono>
+#include <vector>
+#include <functional>
 
 #include "audio/audiolistener.hpp"
 #include "audio/audiobuffer.hpp"
@@ -35,9 +38,47 @@ namespace engine {
 
         virtual AudioListener &getListener() = 0;
 
+        /**
+         * @return The output frequency obtained from the driver in Hz.
+         */
+        virtual unsigned int getFrequency() = 0;
+
+        /**
+         * @return The number of mixing updates per second obtained from the driver.
+         */
+        virtual unsigned int getRefreshRate() = 0;
+
+        /**
+         * @return The time between starting a source and its first sample reaching the output.
+         */
+        virtual std::chrono::nanoseconds getLatency() = 0;
+
+        /**
+         * @return True if buffers of this context accept data in the given format.
+         */
+        virtual bool isFormatSupported(AudioFormat format) = 0;
+
         virtual std::unique_ptr<AudioBuffer> createBuffer() = 0;
 
         virtual std::unique_ptr<AudioSource> createSource() = 0;
+
+        /**
+         * Query the playback state of multiple sources at once.
+         *
+         * @param sources The sources to query, must have been created by this context.
+         * @param states Receives the state of each source in the order of sources.
+         */
+        virtual void getSourceStates(const std::vector<std::reference_wrapper<AudioSource>> &sources,
+                                     std::vector<AudioSource::SourceState> &states) = 0;
+
+        /**
+         * Query the playback position in seconds of multiple sources at once.
+         *
+         * @param sources The sources to query, must have been created by this context.
+         * @param offsets Receives the offset of each source in the order of sources.
+         */
+        virtual void getSourceOffsets(const std::vector<std::reference_wrapper<AudioSource>> &sources,
+                                      std::vector<float> &offsets) = 0;
     };
 }
 
@@ -0,0 +1,45 @@
+/**
+ *  Mana - 3D Game Engine
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MANA_AUDIOCONTEXTCONFIG_HPP
+#define MANA_AUDIOCONTEXTCONFIG_HPP
+
+namespace engine {
+    /**
+     * Requested mixing parameters for a context, zero values leave the choice to the driver.
+     * The driver may not honor the request, the obtained values can be queried from the created context.
+     */
+    struct AudioContextConfig {
+        unsigned int frequency = 0; // The output frequency in Hz
+        unsigned int refreshRate = 0; // The number of mixing updates per second
+        unsigned int periodSize = 0; // The number of frames per mixing update, takes precedence over refreshRate
+
+        /**
+         * @return A configuration requesting small mixing periods at 48kHz.
+         */
+        static AudioContextConfig lowLatency() {
+            AudioContextConfig ret;
+            ret.frequency = 48000;
+            ret.periodSize = 256;
+            return ret;
+        }
+    };
+}
+
+#endif //MANA_AUDIOCONTEXTCONFIG_HPP
@@ -24,6 +24,7 @@
 #include <memory>
 
 #include "audio/audiocontext.hpp"
+#include "audio/audiocontextconfig.hpp"
 #include "audio/audiobackend.hpp"
 
 namespace engine {
@@ -37,7 +38,7 @@ namespace engine {
 
         virtual ~AudioDevice() = default;
 
-        virtual std::unique_ptr<AudioContext> createContext() = 0;
+        virtual std::unique_ptr<AudioContext> createContext(const AudioContextConfig &config = {}) = 0;
     };
 }
 
@@ -20,6 +20,8 @@
 #ifndef MANA_AUDIOFORMAT_HPP
 #define MANA_AUDIOFORMAT_HPP
 
+#include <cstddef>
+
 namespace engine {
     enum AudioFormat {
         MONO8,
@@ -27,8 +29,50 @@ namespace engine {
         STEREO8,
         STEREO16,
         BFORMAT2D_16,
-        BFORMAT3D_16
+        BFORMAT3D_16,
+        MONO_FLOAT32,
+        STEREO_FLOAT32,
+        BFORMAT2D_FLOAT32,
+        BFORMAT3D_FLOAT32
     };
+
+    inline size_t getChannelCount(AudioFormat format) {
+        switch (format) {
+            case MONO8:
+            case MONO16:
+            case MONO_FLOAT32:
+                return 1;
+            case STEREO8:
+            case STEREO16:
+            case STEREO_FLOAT32:
+                return 2;
+            case BFORMAT2D_16:
+            case BFORMAT2D_FLOAT32:
+                return 3;
+            case BFORMAT3D_16:
+            case BFORMAT3D_FLOAT32:
+                return 4;
+        }
+        return 0;
+    }
+
+    /**
+     * @return The size of a single sample of one channel in bytes.
+     */
+    inline size_t getSampleSize(AudioFormat format) {
+        switch (format) {
+            case MONO8:
+            case STEREO8:
+                return 1;
+            case MONO16:
+            case STEREO16:
+            case BFORMAT2D_16:
+            case BFORMAT3D_16:
+                return 2;
+            default:
+                return 4;
+        }
+    }
 }
 
 #endif //MANA_AUDIOFORMAT_HPP
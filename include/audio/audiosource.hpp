@@ -116,8 +116,16 @@ namespace engine {
 
         virtual bool getLooping() = 0;
 
+        /**
+         * Queries the playback state from the driver, all other getters return cached values.
+         */
         virtual SourceState getState() = 0;
 
+        /**
+         * @return The playback position in seconds, queried from the driver.
+         */
+        virtual float getOffset() = 0;
+
         virtual void setBuffer(const AudioBuffer &buffer) = 0;
 
         virtual void clearBuffer() = 0;
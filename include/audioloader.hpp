@@ -21,14 +21,115 @@
 #define METRONOME_AUDIOLOADER_HPP
 
 #include <memory>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <functional>
 
 #include "audio/audiobuffer.hpp"
 #include "audio/audiocontext.hpp"
 
 namespace engine {
-    std::unique_ptr<AudioBuffer> loadAudioBuffer(const std::string &path, AudioContext &context);
+    /**
+     * Processing applied to samples at load time.
+     *
+     * The onset of every sample is detected and stored in the buffer metadata, the pre-roll before it is
+     * either trimmed or left in place for the caller to compensate. The peak and loudness are measured as well
+     * and can be used to bake a normalization gain into the data.
+     *
+     * Segment loads (headDuration > 0) measure the whole sample before they decode their segment, so the head
+     * and the remainder of a sample get the same onset, trim and gain as a complete load.
+     */
+    struct AudioLoadOptions {
+        bool resample = false; // Convert the sample to the output frequency of the context
+        bool trimSilence = false; // Remove the pre-roll before the transient onset except for onsetMargin
+        float onsetThreshold = 0.0316f; // The onset is the first sample reaching this fraction of the peak (-30 dB)
+        float onsetMargin = 0.0005f; // Seconds kept before the onset when trimming so that the attack stays intact
+        bool normalize = false; // Scale the data so that its short-term loudness matches targetLoudness without clipping
+        float targetLoudness = -20; // dBFS
+        bool cache = false; // Reuse the processed data of identical samples from the on-disk sample cache
+        float headDuration = 0; // Load only this many seconds after the trimmed pre-roll, marking the metadata partial, 0 loads everything
+        bool remainder = false; // Load what follows the head segment of headDuration seconds instead of the head
+        bool readFiles = false; // Read files instead of mapping them, for files which may be rewritten in place meanwhile
+    };
 
-    std::unique_ptr<AudioBuffer> loadAudioBufferData(const std::string &data, AudioContext &context);
+    /**
+     * A sample of a batch load, read from the file at path or if path is empty decoded from the data in memory.
+     * The data is not copied and must stay valid until the load returns.
+     */
+    struct AudioLoadRequest {
+        std::string path;
+        const void *data = nullptr;
+        size_t size = 0;
+        bool pcm = false; // The data holds PCM prepared by the asset pipeline which is uploaded without processing
+    };
+
+    /**
+     * PCM in a format accepted by AudioBuffer::upload.
+     */
+    struct DecodedAudio {
+        std::vector<uint8_t> data;
+        AudioFormat format = MONO16;
+        unsigned int frequency = 0;
+        AudioMetadata metadata;
+
+        // The file as libsndfile opened it, zero if the result was taken from the sample cache.
+        int sourceFormat = 0;
+        int sourceChannels = 0;
+        unsigned int sourceFrequency = 0;
+        int64_t sourceFrames = 0;
+    };
+
+    /**
+     * Invoked after every upload of a batch load with the number of loaded samples and the size of the batch.
+     */
+    typedef std::function<void(size_t loaded, size_t total)> AudioLoadProgress;
+
+    std::unique_ptr<AudioBuffer> loadAudioBuffer(const std::string &path,
+                                                 AudioContext &context,
+                                                 const AudioLoadOptions &options = {});
+
+    std::unique_ptr<AudioBuffer> loadAudioBufferData(const std::string &data,
+                                                     AudioContext &context,
+                                                     const AudioLoadOptions &options = {});
+
+    /**
+     * Decode audio data directly from the given memory without copying it.
+     */
+    std::unique_ptr<AudioBuffer> loadAudioBufferData(const void *data,
+                                                     size_t size,
+                                                     AudioContext &context,
+                                                     const AudioLoadOptions &options = {});
+
+    /**
+     * Upload PCM prepared by the asset pipeline, which starts with a header describing the format.
+     */
+    std::unique_ptr<AudioBuffer> loadAudioBufferPcm(const void *data, size_t size, AudioContext &context);
+
+    /**
+     * Decode and process a file without a context, used to prepare samples ahead of time.
+     * The result is always 16 bit.
+     *
+     * @param frequency The frequency to convert to if options.resample is set.
+     */
+    DecodedAudio decodeAudioFile(const std::string &path,
+                                 unsigned int frequency,
+                                 const AudioLoadOptions &options = {});
+
+    /**
+     * Decode the requested samples in parallel on a thread pool and upload them on the calling thread.
+     *
+     * The context has to be current process wide, as AudioContext::makeCurrent makes it, so that the calling
+     * thread may differ from the thread playing the buffers. Loads which create buffers of the same context
+     * must be serialized by the caller, the Metronome runs all of them on its loader thread.
+     * If any sample fails to load the remaining ones are skipped and the error is rethrown.
+     *
+     * @return The buffers in the order of the requests.
+     */
+    std::vector<std::unique_ptr<AudioBuffer>> loadAudioBuffers(const std::vector<AudioLoadRequest> &requests,
+                                                               AudioContext &context,
+                                                               const AudioLoadOptions &options = {},
+                                                               const AudioLoadProgress &progress = {});
 }
 
 #endif //METRONOME_AUDIOLOADER_HPP
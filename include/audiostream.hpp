@@ -0,0 +1,104 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef METRONOME_AUDIOSTREAM_HPP
+#define METRONOME_AUDIOSTREAM_HPP
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <deque>
+
+#include <cstdint>
+
+#include "audio/audiocontext.hpp"
+
+namespace engine {
+    /**
+     * Plays a long audio file with constant memory usage.
+     *
+     * A background thread decodes fixed size chunks into a lock-free ring which update() drains into the
+     * buffers queued on a streaming source. Seeking discards the decoded chunks by advancing a generation
+     * counter, so the decoder starts over at the new position without waiting for the ring to drain.
+     */
+    class AudioStream {
+    public:
+        AudioStream(const std::string &path, AudioContext &context);
+
+        ~AudioStream();
+
+        AudioStream(const AudioStream &) = delete;
+
+        AudioStream &operator=(const AudioStream &) = delete;
+
+        void play();
+
+        void pause();
+
+        /**
+         * Stop playback and rewind to the start.
+         */
+        void stop();
+
+        /**
+         * @param seconds The position to continue playback at, clamped to the duration.
+         */
+        void seek(double seconds);
+
+        /**
+         * @return The playback position in seconds.
+         */
+        double getPosition();
+
+        double getDuration() const;
+
+        void setLooping(bool looping);
+
+        void setGain(float gain);
+
+        /**
+         * Queue decoded chunks on the source and restart it after an underrun.
+         * Has to be called regularly from the thread the context is current on, at least once per chunk duration.
+         */
+        void update();
+
+    private:
+        struct Decoder;
+
+        void unqueueProcessed();
+
+        std::unique_ptr<Decoder> decoder;
+
+        std::unique_ptr<AudioSource> source;
+        std::vector<std::unique_ptr<AudioBuffer>> buffers;
+        std::vector<AudioBuffer *> freeBuffers;
+        std::deque<uint64_t> queuedFrames; // The stream position of every queued buffer
+        std::vector<int16_t> conversion;
+
+        AudioFormat format;
+        unsigned int frequency;
+        size_t channels;
+        uint64_t frames;
+
+        uint64_t position = 0; // The stream position when no buffer is queued
+        bool playing = false;
+    };
+}
+
+#endif //METRONOME_AUDIOSTREAM_HPP
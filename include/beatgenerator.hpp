@@ -22,6 +22,7 @@
 
 #include <chrono>
 #include <set>
+#include <algorithm>
 
 class BeatGenerator {
 public:
@@ -30,23 +31,36 @@ public:
         accumulator = targetDuration;
     }
 
+    /**
+     * @return Zero if a beat should be triggered now, otherwise the time until the next beat.
+     */
     std::chrono::high_resolution_clock::duration update() {
         auto now = std::chrono::high_resolution_clock::now();
         accumulator += now - lastUpdate;
-        std::chrono::high_resolution_clock::duration ret;
-        if (accumulator >= targetDuration) {
-            accumulator = std::chrono::high_resolution_clock::duration(0);
-            ret = std::chrono::high_resolution_clock::duration(0);
+        lastUpdate = now;
+        if (accumulator + leadTime >= targetDuration) {
+            // Keep the overshoot so that late updates do not accumulate into drift, but skip beats which were missed entirely.
+            accumulator -= targetDuration;
+            if (accumulator >= targetDuration)
+                accumulator %= targetDuration;
+            return std::chrono::high_resolution_clock::duration(0);
         } else {
-            ret = targetDuration - accumulator;
+            return targetDuration - leadTime - accumulator;
         }
-        lastUpdate = now;
-        return ret;
     }
 
     void setBPM(uint32_t value) {
         targetDuration = std::chrono::high_resolution_clock::duration(static_cast<int64_t>(NANOSECONDS_PER_MINUTE)
                                                                       / static_cast<int64_t>(value));
+        leadTime = std::min(leadTime, targetDuration);
+    }
+
+    /**
+     * Trigger beats earlier by the given duration, used to compensate the output latency and sample pre-roll.
+     * The lead time may change between beats without shifting the beat grid and is clamped to the beat duration.
+     */
+    void setLeadTime(std::chrono::high_resolution_clock::duration value) {
+        leadTime = std::max(std::chrono::high_resolution_clock::duration(0), std::min(value, targetDuration));
     }
 
 private:
@@ -55,6 +69,7 @@ private:
     std::chrono::high_resolution_clock::duration targetDuration;
     std::chrono::high_resolution_clock::time_point lastUpdate;
     std::chrono::high_resolution_clock::duration accumulator;
+    std::chrono::high_resolution_clock::duration leadTime = std::chrono::high_resolution_clock::duration(0);
 };
 
 #endif //METRONOME_BEATGENERATOR_HPP
\ No newline at end of file
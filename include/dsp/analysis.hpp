@@ -0,0 +1,44 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef METRONOME_ANALYSIS_HPP
+#define METRONOME_ANALYSIS_HPP
+
+#include <cstddef>
+
+namespace engine {
+    struct SignalLevel {
+        float minimum = 0;
+        float maximum = 0;
+        float peak = 0; // The largest magnitude
+        double energy = 0; // The sum of squares
+    };
+
+    /**
+     * Measure the range, peak and energy of the samples in one pass.
+     */
+    SignalLevel measureLevel(const float *samples, size_t count);
+
+    /**
+     * @return The index of the first sample with a magnitude greater or equal to threshold or count if there is none.
+     */
+    size_t findFirstAbove(const float *samples, size_t count, float threshold);
+}
+
+#endif //METRONOME_ANALYSIS_HPP
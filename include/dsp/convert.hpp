@@ -0,0 +1,67 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef METRONOME_CONVERT_HPP
+#define METRONOME_CONVERT_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+namespace engine {
+    /**
+     * Convert signed 16 bit samples to floats in the range [-1, 1).
+     */
+    void convertInt16ToFloat(const int16_t *in, float *out, size_t count);
+
+    /**
+     * Convert floats in the range [-1, 1] to signed 16 bit samples, rounding to nearest and saturating out of range values.
+     * out may point to the same memory as in to convert in place.
+     */
+    void convertFloatToInt16(const float *in, int16_t *out, size_t count);
+
+    /**
+     * Multiply the samples by gain in place.
+     */
+    void applyGain(float *samples, size_t count, float gain);
+
+    /**
+     * Mix interleaved frames of inChannels into interleaved frames of outChannels.
+     *
+     * @param matrix The gains of every input channel for every output channel, outChannels rows of inChannels columns.
+     * The input and output must not overlap.
+     */
+    void mixChannels(const float *in,
+                     size_t inChannels,
+                     float *out,
+                     size_t outChannels,
+                     const float *matrix,
+                     size_t frames);
+
+    /**
+     * Split interleaved frames into one buffer per channel.
+     */
+    void deinterleave(const float *in, float *const *out, size_t channels, size_t frames);
+
+    /**
+     * Merge one buffer per channel into interleaved frames.
+     */
+    void interleave(const float *const *in, float *out, size_t channels, size_t frames);
+}
+
+#endif //METRONOME_CONVERT_HPP
@@ -0,0 +1,71 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef METRONOME_RESAMPLER_HPP
+#define METRONOME_RESAMPLER_HPP
+
+#include <vector>
+
+#include <cstddef>
+
+namespace engine {
+    /**
+     * Polyphase windowed sinc sample rate converter for offline conversion of whole channels.
+     *
+     * The ratio is reduced to lowest terms and every phase gets its own precomputed filter,
+     * ratios which would need more than MAXIMUM_PHASES filters use the closest of MAXIMUM_PHASES phases.
+     */
+    class Resampler {
+    public:
+        static constexpr size_t MAXIMUM_PHASES = 1024;
+
+        /**
+         * @param zeroCrossings The number of sinc zero crossings on each side of the filter center, controls quality and cost.
+         */
+        Resampler(unsigned int inputRate, unsigned int outputRate, unsigned int zeroCrossings = 16);
+
+        size_t getOutputFrames(size_t inputFrames) const;
+
+        /**
+         * The number of silent frames required before and after the input passed to process.
+         */
+        size_t getPadding() const {
+            return taps;
+        }
+
+        /**
+         * Resample a single channel.
+         *
+         * @param in The input frames, in[-getPadding()] to in[inputFrames + getPadding() - 1] must be readable and should be zero outside of the signal.
+         * @param out Receives getOutputFrames(inputFrames) samples
+         * @param outStride The distance between output samples, used to write directly into interleaved frames.
+         */
+        void process(const float *in, size_t inputFrames, float *out, size_t outStride = 1) const;
+
+    private:
+        size_t interpolation; // Reduced output rate
+        size_t decimation; // Reduced input rate
+        size_t phases;
+        size_t taps; // Filter length, a multiple of 8
+        size_t halfTaps;
+        std::vector<float> filters; // phases + 1 filters of taps coefficients
+    };
+}
+
+#endif //METRONOME_RESAMPLER_HPP
@@ -0,0 +1,82 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef METRONOME_FILEWATCHER_HPP
+#define METRONOME_FILEWATCHER_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+namespace engine {
+    /**
+     * Reports modifications of files using inotify.
+     *
+     * The parent directories of the files are watched instead of the files themselves so that editors which
+     * save by renaming a temporary file over the original are detected as well. The watcher thread blocks in
+     * poll while none of the files change and reports a file once it has not been written to for the debounce delay,
+     * so a burst of writes results in a single notification.
+     */
+    class FileWatcher {
+    public:
+        /**
+         * Invoked on the watcher thread with the path of a modified file as it was passed to watch.
+         */
+        typedef std::function<void(const std::string &path)> Callback;
+
+        explicit FileWatcher(Callback callback,
+                             std::chrono::milliseconds debounce = std::chrono::milliseconds(250));
+
+        ~FileWatcher();
+
+        FileWatcher(const FileWatcher &) = delete;
+
+        FileWatcher &operator=(const FileWatcher &) = delete;
+
+        /**
+         * Replace the set of watched files.
+         *
+         * Files in directories which cannot be watched are ignored.
+         */
+        void watch(const std::vector<std::string> &paths);
+
+    private:
+        void run();
+
+        Callback callback;
+        std::chrono::milliseconds debounce;
+
+        int notifyDescriptor;
+        int wakeDescriptor;
+
+        std::mutex mutex;
+        // The watched file names and their paths as passed to watch by the descriptor of their directory.
+        std::map<int, std::multimap<std::string, std::string>> directories;
+
+        std::atomic<bool> runFlag{true};
+        std::thread thread;
+    };
+}
+
+#endif //METRONOME_FILEWATCHER_HPP
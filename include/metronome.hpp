@@ -23,43 +23,182 @@
 #include <thread>
 #include <functional>
 #include <condition_variable>
+#include <algorithm>
+#include <future>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <iostream>
 
 #include "beatgenerator.hpp"
 #include "sampleplayer.hpp"
+#include "audiostream.hpp"
+#include "filewatcher.hpp"
+#include "waveform.hpp"
 
 class Metronome {
 public:
     /**
-     * @param beatInterval How many times per second should the metronome thread update the beat generator, Corresponds to the maximum bpm
+     * @param beatInterval How many times per second the metronome thread updates the beat generator at least while waiting for the next beat
      */
     Metronome(int beatInterval = 20)
             : beatInterval(beatInterval) {
         //thread = std::thread(std::bind(&Metronome::loop, this, std::placeholders::_1));
         thread = std::thread([this]() { loop(); });
+        loaderThread = std::thread([this]() { loaderLoop(); });
     }
 
     Metronome(int beatInterval, int bpm, const std::string &samplePath)
             : beatInterval(beatInterval) {
         beatGenerator.setBPM(bpm);
-        samplePlayer.setSamplePath(samplePath);
         thread = std::thread([this]() { loop(); });
+        loaderThread = std::thread([this]() { loaderLoop(); });
+        setSamplePath(samplePath);
     }
 
     ~Metronome() {
-        runFlag = false;
+        {
+            std::lock_guard<std::mutex> guard(loaderMutex);
+            loaderRunFlag = false;
+        }
+        loaderCondition.notify_all();
+        loaderThread.join();
+
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            runFlag = false;
+        }
+        playingCondition.notify_all();
         thread.join();
+
+        delete pendingKit.exchange(nullptr);
+        for (auto *pending = pendingRemainders.exchange(nullptr); pending;) {
+            auto *next = pending->next;
+            delete pending;
+            pending = next;
+        }
     }
 
+    /**
+     * Load the sample and block until it is loaded, the metronome keeps playing the previous kit meanwhile.
+     */
     void setSamplePath(const std::string &path) {
-        std::lock_guard<std::mutex> guard(mutex);
-        samplePlayer.setSamplePath(path);
-        beatGenerator.reset();
+        loadKitAsync(SampleKit::fromPath(path)).get();
     }
 
     void setSampleData(const std::string &data) {
+        loadKitAsync(SampleKit::fromData(data)).get();
+    }
+
+    void setLoadOptions(const engine::AudioLoadOptions &options) {
         std::lock_guard<std::mutex> guard(mutex);
-        samplePlayer.setSampleData(data);
-        beatGenerator.reset();
+        samplePlayer.setLoadOptions(options);
+    }
+
+    void setKit(const SampleKit &kit) {
+        loadKitAsync(kit).get();
+    }
+
+    /**
+     * Make kits loaded afterwards playable before they are decoded completely.
+     *
+     * The first headDuration seconds of every sample are loaded and activated first so that the time until the
+     * first click does not grow with the sample length. The rest of every sample is loaded afterwards and queued
+     * behind the head on its voices, so clicks which are playing continue into it. Both parts are trimmed and
+     * normalized with the onset and loudness measured on the whole sample.
+     *
+     * @param headDuration The length of the head segment in seconds, 0 disables progressive loading.
+     */
+    void setProgressiveLoading(float headDuration) {
+        std::lock_guard<std::mutex> guard(mutex);
+        progressiveHead = headDuration;
+    }
+
+    /**
+     * Load the kit on the loader thread without blocking the caller or the beat thread.
+     *
+     * The loaded kit replaces the active one at the next beat. If another kit finishes loading before that beat
+     * only the most recent one is activated.
+     *
+     * @param onFinished Invoked on the loader thread once the kit is loaded or loading failed,
+     * with the exception of the failure or a null pointer.
+     * @return A future which becomes ready at the same time and rethrows load failures from get().
+     */
+    std::future<void> loadKitAsync(const SampleKit &kit,
+                                   std::function<void(std::exception_ptr)> onFinished = {}) {
+        engine::AudioLoadOptions options;
+        float headDuration;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            options = samplePlayer.getLoadOptions();
+            headDuration = progressiveHead;
+        }
+
+        auto task = std::make_shared<std::packaged_task<void()>>(
+                [this, kit, options, headDuration, onFinished]() {
+                    try {
+                        loadKit(kit, options, headDuration);
+                    } catch (...) {
+                        if (onFinished)
+                            onFinished(std::current_exception());
+                        throw;
+                    }
+                    if (onFinished)
+                        onFinished(nullptr);
+                });
+        auto ret = task->get_future();
+        {
+            std::lock_guard<std::mutex> guard(loaderMutex);
+            loaderQueue.emplace_back(std::move(task));
+        }
+        loaderCondition.notify_one();
+        return ret;
+    }
+
+    /**
+     * @return The waveform of a sample of the most recently loaded kit, null if there is none.
+     */
+    std::shared_ptr<const engine::Waveform> getWaveform(size_t sample = 0) {
+        std::lock_guard<std::mutex> guard(loaderMutex);
+        if (sample >= loadedWaveforms.size())
+            return nullptr;
+        return loadedWaveforms[sample];
+    }
+
+    /**
+     * Set the listener which is invoked on the loader thread after a sample file of the kit
+     * was modified and reloaded, with the exception of the failure or a null pointer.
+     */
+    void setReloadListener(std::function<void(const std::string &path, std::exception_ptr)> listener) {
+        std::lock_guard<std::mutex> guard(loaderMutex);
+        reloadListener = std::move(listener);
+    }
+
+    /**
+     * Set a track which is streamed from disk and plays along with the click from the start.
+     *
+     * @param path The file to stream, an empty path removes the backing track.
+     */
+    void setBackingTrack(const std::string &path) {
+        // Opening the file and starting or joining the decoder thread happen outside of the mutex of the beat thread.
+        std::unique_ptr<engine::AudioStream> track;
+        if (!path.empty())
+            track = std::make_unique<engine::AudioStream>(path, samplePlayer.getContext());
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            if (track && playing)
+                track->play();
+            std::swap(backingTrack, track);
+        }
+    }
+
+    /**
+     * @param beats The number of beats per bar, the first beat of every bar plays the downbeat kit piece.
+     */
+    void setBeatsPerBar(int beats) {
+        std::lock_guard<std::mutex> guard(mutex);
+        beatsPerBar = std::max(beats, 1);
+        beat = 0;
     }
 
     void setBPM(int bpm) {
@@ -70,7 +209,15 @@ public:
 
     void start() {
         std::lock_guard<std::mutex> guard(mutex);
+        latency = samplePlayer.getLatency();
+        applyPendingRemainders();
+        applyPendingKit();
         beatGenerator.reset();
+        beat = 0;
+        if (backingTrack) {
+            backingTrack->stop();
+            backingTrack->play();
+        }
         playing = true;
         playingCondition.notify_all();
     }
@@ -79,32 +226,49 @@ public:
         std::lock_guard<std::mutex> guard(mutex);
         playing = false;
         samplePlayer.stop();
+        if (backingTrack)
+            backingTrack->stop();
     }
 
     bool isPlaying() {
         return playing;
     }
 
+    VoicePool::Statistics getVoiceStatistics() {
+        std::lock_guard<std::mutex> guard(mutex);
+        return samplePlayer.getVoiceStatistics();
+    }
+
 private:
     void loop() {
         while (runFlag) {
             std::unique_lock<std::mutex> guard(mutex);
             if (playing) {
-                //TODO: Fix drift
-                // The beat generator update includes the time any cycles between update invocations and
-                // the beat generator instructions themselves took so there should not be any drift caused by the beat generator.
-                // Most likely a problem with OpenALSoft latency as it spins another thread.
+                if (backingTrack)
+                    backingTrack->update();
+                applyPendingRemainders();
+                samplePlayer.update();
+                // The beat generator triggers early by the measured output latency and the pre-roll of the
+                // sample which plays next so that the transient is heard on the beat.
+                auto piece = beat == 0 ? SampleKit::DOWNBEAT : SampleKit::BEAT;
+                beatGenerator.setLeadTime(latency + samplePlayer.getOnset(piece));
                 auto time = beatGenerator.update();
                 if (time.count() == 0) {
-                    samplePlayer.play();
+                    if (applyPendingKit())
+                        beatGenerator.setLeadTime(latency + samplePlayer.getOnset(piece));
+                    if (samplePlayer.isLoaded())
+                        samplePlayer.play(piece);
+                    beat = (beat + 1) % beatsPerBar;
                 } else {
                     guard.unlock();
-                    std::this_thread::sleep_for(std::chrono::duration<double>(
-                            1.0f / static_cast<double>(beatInterval)));
+                    // Wake up for the next beat instead of overshooting it by up to one interval.
+                    std::this_thread::sleep_for(std::min<std::chrono::duration<double>>(
+                            time,
+                            std::chrono::duration<double>(1.0f / static_cast<double>(beatInterval))));
                 }
             } else {
                 playingCondition.wait(guard, [this] {
-                    if (playing)
+                    if (playing || !runFlag)
                         return true;
                     else
                         return false;
@@ -113,6 +277,178 @@ private:
         }
     }
 
+    /**
+     * Runs the queued kit loads one after another so that decoding never holds the mutex of the beat thread.
+     */
+    void loaderLoop() {
+        while (true) {
+            std::shared_ptr<std::packaged_task<void()>> task;
+            {
+                std::unique_lock<std::mutex> guard(loaderMutex);
+                loaderCondition.wait(guard, [this] { return !loaderQueue.empty() || !loaderRunFlag; });
+                if (!loaderRunFlag)
+                    return;
+                task = std::move(loaderQueue.front());
+                loaderQueue.pop_front();
+            }
+            (*task)();
+        }
+    }
+
+    /**
+     * Load the kit on the loader thread and publish it, with only the head segments of the samples
+     * followed by their remainders if headDuration is greater than zero.
+     */
+    void loadKit(const SampleKit &kit, const engine::AudioLoadOptions &options, float headDuration) {
+        if (!(headDuration > 0)) {
+            publishKit(kit, samplePlayer.loadKit(kit, options));
+            return;
+        }
+
+        auto headOptions = options;
+        headOptions.headDuration = headDuration;
+        auto head = samplePlayer.loadKit(kit, headOptions);
+        auto samples = head->samples;
+        publishKit(kit, std::move(head));
+
+        // Samples which were loaded completely, because they are short, cached or prepared PCM, have no remainder.
+        auto remainderOptions = headOptions;
+        remainderOptions.remainder = true;
+        auto remainders = samplePlayer.loadRemainders(kit, samples, remainderOptions);
+
+        auto pending = std::make_unique<PendingRemainders>();
+        for (size_t i = 0; i < remainders.size(); i++) {
+            if (remainders[i])
+                pending->remainders.emplace_back(samples[i].voices, std::move(remainders[i]));
+        }
+        if (pending->remainders.empty())
+            return;
+        pending->next = pendingRemainders.load();
+        while (!pendingRemainders.compare_exchange_weak(pending->next, pending.get())) {}
+        pending.release();
+    }
+
+    /**
+     * Queue a reload of the kit samples loaded from the modified file at path, invoked by the watcher.
+     */
+    void reloadSample(const std::string &path) {
+        auto task = std::make_shared<std::packaged_task<void()>>([this, path]() {
+            // Decode only the modified file and share the buffers and voices of all other samples with the current kit.
+            auto reuse = loadedSamples;
+            bool modified = false;
+            for (size_t i = 0; i < loadedKit.samples.size() && i < reuse.size(); i++) {
+                if (loadedKit.samples[i].path == path) {
+                    reuse[i] = {};
+                    modified = true;
+                }
+            }
+            if (!modified)
+                return;
+
+            engine::AudioLoadOptions options;
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                options = samplePlayer.getLoadOptions();
+            }
+            // The editor which modified the file may still be rewriting it.
+            options.readFiles = true;
+
+            std::exception_ptr error;
+            try {
+                publishKit(loadedKit, samplePlayer.loadKit(loadedKit, options, {}, reuse));
+            } catch (...) {
+                // A file which fails to decode keeps playing the previously loaded version.
+                error = std::current_exception();
+            }
+
+            std::function<void(const std::string &, std::exception_ptr)> listener;
+            {
+                std::lock_guard<std::mutex> guard(loaderMutex);
+                listener = reloadListener;
+            }
+            if (listener)
+                listener(path, error);
+        });
+        {
+            std::lock_guard<std::mutex> guard(loaderMutex);
+            loaderQueue.emplace_back(std::move(task));
+        }
+        loaderCondition.notify_one();
+    }
+
+    /**
+     * @return The watcher which reloads modified sample files, or null without hot reloading if the system
+     * refuses to watch files, for example because the inotify instance limit is reached.
+     */
+    std::unique_ptr<engine::FileWatcher> createWatcher() {
+        try {
+            return std::make_unique<engine::FileWatcher>([this](const std::string &path) { reloadSample(path); });
+        } catch (const std::exception &e) {
+            std::cerr << "Warning: Modified sample files are not reloaded\n" << e.what() << std::endl;
+            return nullptr;
+        }
+    }
+
+    /**
+     * Hand a kit loaded on the loader thread to the beat thread and watch its sample files.
+     */
+    void publishKit(const SampleKit &kit, std::unique_ptr<SamplePlayer::LoadedKit> loaded) {
+        loadedKit = kit;
+        loadedSamples = loaded->samples;
+
+        std::vector<std::shared_ptr<const engine::Waveform>> waveforms;
+        for (auto &sample: loadedSamples)
+            waveforms.emplace_back(sample.buffer->getMetadata().waveform);
+        {
+            std::lock_guard<std::mutex> guard(loaderMutex);
+            loadedWaveforms = std::move(waveforms);
+        }
+
+        std::vector<std::string> paths;
+        for (auto &sample: kit.samples) {
+            if (!sample.path.empty())
+                paths.emplace_back(sample.path);
+        }
+        if (watcher)
+            watcher->watch(paths);
+
+        delete pendingKit.exchange(loaded.release());
+    }
+
+    /**
+     * Activate the most recently loaded kit if there is one, must be called with the mutex held.
+     *
+     * @return True if the active kit was replaced.
+     */
+    bool applyPendingKit() {
+        std::unique_ptr<SamplePlayer::LoadedKit> kit(pendingKit.exchange(nullptr));
+        if (!kit)
+            return false;
+        samplePlayer.setKit(std::move(kit));
+        return true;
+    }
+
+    /**
+     * Append the remainders loaded since the last call to the voices of their samples, must be called with the mutex held.
+     * The voices are shared by every kit holding the samples, including replaced kits which are ringing out.
+     */
+    void applyPendingRemainders() {
+        std::unique_ptr<PendingRemainders> pending(pendingRemainders.exchange(nullptr));
+        while (pending) {
+            for (auto &remainder: pending->remainders)
+                remainder.first->append(std::move(remainder.second));
+            pending.reset(pending->next);
+        }
+    }
+
+    /**
+     * The remainders of one progressive load, chained to the ones published before it.
+     */
+    struct PendingRemainders {
+        std::vector<std::pair<std::shared_ptr<VoicePool>, std::shared_ptr<const engine::AudioBuffer>>> remainders;
+        PendingRemainders *next = nullptr;
+    };
+
     std::mutex mutex;
 
     bool runFlag = true;
@@ -120,11 +456,37 @@ private:
 
     int beatInterval;
 
+    std::chrono::nanoseconds latency{0};
+    float progressiveHead = 0; // The head segment duration of progressive loads in seconds
+
+    int beatsPerBar = 4;
+    int beat = 0;
+
     bool playing = false;
     std::condition_variable playingCondition;
 
     BeatGenerator beatGenerator;
     SamplePlayer samplePlayer;
+    std::unique_ptr<engine::AudioStream> backingTrack; // Destroyed before the context of the sample player
+
+    // Owned by the loader thread until the beat thread takes it, handed over without locking the mutex.
+    std::atomic<SamplePlayer::LoadedKit *> pendingKit{nullptr};
+    std::atomic<PendingRemainders *> pendingRemainders{nullptr};
+
+    std::mutex loaderMutex;
+    std::condition_variable loaderCondition;
+    std::deque<std::shared_ptr<std::packaged_task<void()>>> loaderQueue;
+    bool loaderRunFlag = true;
+    std::thread loaderThread;
+    std::function<void(const std::string &, std::exception_ptr)> reloadListener;
+    std::vector<std::shared_ptr<const engine::Waveform>> loadedWaveforms; // Guarded by the loader mutex
+
+    // The most recently loaded kit and its samples, only accessed by the loader thread.
+    SampleKit loadedKit;
+    std::vector<SamplePlayer::Sample> loadedSamples;
+
+    // Destroyed first because its thread queues reloads, null if files cannot be watched.
+    std::unique_ptr<engine::FileWatcher> watcher = createWatcher();
 };
 
 #endif //METRONOME_METRONOME_HPP
@@ -0,0 +1,116 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef METRONOME_SAMPLEBANK_HPP
+#define METRONOME_SAMPLEBANK_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "audio/audiocontext.hpp"
+
+#include "audioloader.hpp"
+#include "samplekit.hpp"
+
+namespace engine {
+    class MappedFile;
+
+    /**
+     * A single file holding many samples in their playback format.
+     *
+     * The file starts with a header and an index of fixed size entries carrying the name, format and metadata of
+     * every sample, followed by a name table and one page aligned blob per sample. A blob is the PCM prepared by
+     * the asset pipeline: a PcmHeader followed by the data, so it can be uploaded straight from the mapping.
+     * Opening a bank only maps the file and reads the index.
+     */
+    class SampleBank {
+    public:
+        struct Sample {
+            std::string name;
+            const uint8_t *blob; // The PcmHeader followed by the PCM and the waveform
+            size_t blobSize;
+            AudioFormat format;
+            unsigned int frequency;
+            size_t channels;
+            size_t frames;
+            AudioMetadata metadata; // Read from the index, without the waveform stored in the blob
+        };
+
+        struct Entry {
+            std::string name;
+            DecodedAudio audio;
+        };
+
+        /**
+         * Write a bank containing the given samples.
+         *
+         * The bank is written to a temporary file which then replaces the file at path, so banks which are mapped
+         * meanwhile keep their contents.
+         */
+        static void write(const std::string &path, const std::vector<Entry> &entries);
+
+        /**
+         * Map the bank at path and read its index.
+         */
+        explicit SampleBank(const std::string &path);
+
+        ~SampleBank();
+
+        SampleBank(const SampleBank &) = delete;
+
+        SampleBank &operator=(const SampleBank &) = delete;
+
+        size_t getSampleCount() const {
+            return samples.size();
+        }
+
+        const Sample &getSample(size_t index) const {
+            return samples.at(index);
+        }
+
+        /**
+         * @return The index of the sample with the given name or getSampleCount() if there is none.
+         */
+        size_t find(const std::string &name) const;
+
+        /**
+         * Read the waveform stored after the PCM of a sample, which touches only the pages of that blob.
+         *
+         * @return The waveform or null if the sample has none.
+         */
+        std::shared_ptr<const Waveform> getWaveform(size_t index) const;
+
+        /**
+         * Upload the PCM of a sample, the buffer metadata includes the waveform.
+         */
+        std::unique_ptr<AudioBuffer> upload(size_t index, AudioContext &context) const;
+
+        /**
+         * @return A kit sample referencing the blob in the mapping, the bank has to outlive the loading of the kit.
+         */
+        SampleKit::Sample getKitSample(size_t index) const;
+
+    private:
+        std::unique_ptr<MappedFile> file;
+        std::vector<Sample> samples;
+    };
+}
+
+#endif //METRONOME_SAMPLEBANK_HPP
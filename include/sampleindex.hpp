@@ -0,0 +1,101 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef METRONOME_SAMPLEINDEX_HPP
+#define METRONOME_SAMPLEINDEX_HPP
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include <cstdint>
+
+namespace engine {
+    /**
+     * Persistent index of the audio files in a directory tree, so that a sample library can be browsed
+     * and searched without opening the files.
+     *
+     * Updates only open files whose modification time or size changed since the previous update.
+     * Files which are not audio are recorded as well so that they are not probed again.
+     */
+    class SampleIndex {
+    public:
+        struct Entry {
+            std::string path; // Relative to the root directory
+            int64_t modified = 0; // The modification time in nanoseconds since the epoch
+            uint64_t size = 0; // The file size in bytes
+            int format = 0; // The libsndfile format, zero if the file is not audio
+            int channels = 0;
+            int frequency = 0;
+            double duration = 0; // Seconds
+            float onset = 0; // The pre-roll before the transient onset in seconds
+            float loudness = 0; // The short-term loudness in dBFS
+        };
+
+        /**
+         * @return The library index in the XDG data directory.
+         */
+        static std::string getDefaultPath();
+
+        /**
+         * @return The name of the container and encoding of a libsndfile format.
+         */
+        static std::string getFormatName(int format);
+
+        /**
+         * Load the index at path, a missing or invalid index results in an empty index.
+         */
+        explicit SampleIndex(std::string path = getDefaultPath());
+
+        /**
+         * Index the files below root, the entries of a previously indexed root directory are replaced.
+         *
+         * @param progress Invoked with the number of analyzed files and the number of files which need analysis.
+         */
+        void update(const std::string &root, const std::function<void(size_t, size_t)> &progress = {});
+
+        /**
+         * Write the index to its path.
+         */
+        void save() const;
+
+        /**
+         * @return The audio entries whose path contains every whitespace separated term of query, ignoring case.
+         */
+        std::vector<const Entry *> search(const std::string &query) const;
+
+        const std::string &getRoot() const {
+            return root;
+        }
+
+        /**
+         * @return All entries sorted by path, including the files which are not audio.
+         */
+        const std::vector<Entry> &getEntries() const {
+            return entries;
+        }
+
+    private:
+        std::string path;
+        std::string root;
+        std::vector<Entry> entries;
+    };
+}
+
+#endif //METRONOME_SAMPLEINDEX_HPP
@@ -0,0 +1,104 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef METRONOME_SAMPLEKIT_HPP
+#define METRONOME_SAMPLEKIT_HPP
+
+#include <string>
+#include <vector>
+#include <array>
+
+/**
+ * Describes the samples used for the different kinds of clicks.
+ *
+ * Every piece has a list of velocity layers and every layer a list of round robin alternates,
+ * referencing the kit samples by index so that a sample can be shared between pieces and layers.
+ */
+struct SampleKit {
+    enum Piece {
+        DOWNBEAT,
+        BEAT,
+        SUBDIVISION,
+        GHOST
+    };
+
+    static const size_t PIECE_COUNT = 4;
+
+    struct Sample {
+        std::string path; // The file to load the sample from, if empty the sample is decoded from memory or data.
+        std::string data;
+        const void *memory = nullptr; // Encoded data which is not owned by the kit and must outlive the loading
+        size_t memorySize = 0;
+        bool pcm = false; // The memory holds PCM prepared by the asset pipeline instead of encoded data
+    };
+
+    struct Layer {
+        float minimumVelocity = 0; // The layer is used for velocities greater or equal to this value, [0, 1]
+        std::vector<size_t> samples; // The round robin alternates of this layer
+    };
+
+    std::vector<Sample> samples;
+    std::array<std::vector<Layer>, PIECE_COUNT> pieces;
+
+    /**
+     * @return A kit which uses the sample at path for every piece.
+     */
+    static SampleKit fromPath(const std::string &path) {
+        SampleKit ret;
+        ret.samples.emplace_back(Sample{path, {}});
+        for (auto &piece: ret.pieces)
+            piece.emplace_back(Layer{0, {0}});
+        return ret;
+    }
+
+    /**
+     * @return A kit which uses the encoded sample data for every piece.
+     */
+    static SampleKit fromData(const std::string &data) {
+        SampleKit ret;
+        ret.samples.emplace_back(Sample{{}, data});
+        for (auto &piece: ret.pieces)
+            piece.emplace_back(Layer{0, {0}});
+        return ret;
+    }
+
+    /**
+     * @return A kit which uses the encoded sample data at memory for every piece, the memory is not copied.
+     */
+    static SampleKit fromMemory(const void *memory, size_t size) {
+        SampleKit ret;
+        ret.samples.emplace_back(Sample{{}, {}, memory, size});
+        for (auto &piece: ret.pieces)
+            piece.emplace_back(Layer{0, {0}});
+        return ret;
+    }
+
+    /**
+     * @return A kit which uses the PCM at memory prepared by the asset pipeline for every piece, the memory is not copied.
+     */
+    static SampleKit fromPcm(const void *memory, size_t size) {
+        SampleKit ret;
+        ret.samples.emplace_back(Sample{{}, {}, memory, size, true});
+        for (auto &piece: ret.pieces)
+            piece.emplace_back(Layer{0, {0}});
+        return ret;
+    }
+};
+
+#endif //METRONOME_SAMPLEKIT_HPP
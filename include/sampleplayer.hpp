@@ -21,85 +21,360 @@
 #define METRONOME_SAMPLEPLAYER_HPP
 
 #include <mutex>
+#include <algorithm>
 
 #include "audio/audiodevice.hpp"
 
 #include "audioloader.hpp"
+#include "voicepool.hpp"
+#include "samplekit.hpp"
 
 class SamplePlayer {
+private:
+    static const size_t VELOCITY_STEPS = 128;
+
+    typedef std::array<std::array<uint16_t, VELOCITY_STEPS>, SampleKit::PIECE_COUNT> LayerTable;
+
+    struct Slot {
+        std::vector<size_t> alternates; // Indices into samples
+        size_t next;
+    };
+
 public:
+    // OpenAL Soft mixes at most 256 sources by default, the remaining ones are left for streams.
+    static const size_t MAXIMUM_SOURCES = 224;
+
+    /**
+     * A loaded kit sample and the voices playing it, shared with kits reloaded from the kit.
+     */
+    struct Sample {
+        std::shared_ptr<engine::AudioBuffer> buffer;
+        std::shared_ptr<VoicePool> voices; // Destroyed before the buffer
+    };
+
+    /**
+     * The samples and lookup tables of a kit, created by loadKit and activated by setKit.
+     */
+    struct LoadedKit {
+        std::vector<Sample> samples;
+        std::vector<Slot> layerSlots; // One slot per kit layer
+        LayerTable layerTable{};
+    };
+
     /**
-     * @param numberOfSources The number of audio sources to create for playing back the samples. This corresponds to the maximum concurrently playing samples.
+     * The voice pools of all kits, including replaced kits which are ringing out, share MAXIMUM_SOURCES sources.
+     *
+     * @param minimumVoices The number of audio sources to preallocate per kit sample.
+     * @param maximumVoices The number of audio sources the voice pool of a kit sample may grow to. This corresponds to the maximum concurrently playing instances of a sample.
+     * @param contextConfig The mixing parameters to request from the driver.
      */
-    SamplePlayer(int numberOfSources = 20) {
+    SamplePlayer(size_t minimumVoices = 2,
+                 size_t maximumVoices = 20,
+                 const engine::AudioContextConfig &contextConfig = engine::AudioContextConfig::lowLatency())
+            : minimumVoices(minimumVoices), maximumVoices(maximumVoices) {
         audioDevice = engine::AudioDevice::createDevice(engine::OpenAL);
-        audioContext = audioDevice->createContext();
+        audioContext = audioDevice->createContext(contextConfig);
         audioContext->makeCurrent();
-        for (int i = 0; i < numberOfSources; i++) {
-            audioSources.emplace_back(audioContext->createSource());
-        }
     }
 
-    explicit SamplePlayer(int numberOfSources, const std::string &samplePath) {
-        audioDevice = engine::AudioDevice::createDevice(engine::OpenAL);
-        audioContext = audioDevice->createContext();
-        audioContext->makeCurrent();
-        for (int i = 0; i < numberOfSources; i++) {
-            audioSources.emplace_back(audioContext->createSource());
-        }
+    explicit SamplePlayer(size_t minimumVoices, size_t maximumVoices, const std::string &samplePath)
+            : SamplePlayer(minimumVoices, maximumVoices) {
         setSamplePath(samplePath);
     }
 
-    void play() {
-        if (audioSample == nullptr) {
+    /**
+     * Play the sample selected by the kit for the given piece and velocity.
+     *
+     * @param velocity The velocity in the range [0, 1]
+     */
+    void play(SampleKit::Piece piece = SampleKit::BEAT, float velocity = 1) {
+        if (!kit) {
             throw std::runtime_error("No sample loaded");
         }
+        auto &slot = kit->layerSlots[kit->layerTable[piece][quantizeVelocity(velocity)]];
+        auto sample = slot.alternates[slot.next];
+        if (++slot.next >= slot.alternates.size())
+            slot.next = 0;
+        kit->samples[sample].voices->trigger();
+    }
 
-        auto &source = audioSources.at(sourceIndex++);
-
-        if (sourceIndex >= audioSources.size())
-            sourceIndex = 0;
-
-        source->stop();
-        source->play();
+    /**
+     * @return True if a kit is active.
+     */
+    bool isLoaded() const {
+        return kit != nullptr;
     }
 
     void stop() {
-        for (auto &source: audioSources)
-            source->stop();
+        retiredKits.clear();
+        if (!kit)
+            return;
+        for (auto &sample: kit->samples)
+            sample.voices->stop();
+    }
+
+    /**
+     * Release the replaced kits whose voices have finished playing.
+     */
+    void update() {
+        retiredKits.erase(std::remove_if(retiredKits.begin(), retiredKits.end(),
+                                         [](const std::unique_ptr<LoadedKit> &retired) {
+                                             for (auto &sample: retired->samples) {
+                                                 if (sample.voices->isPlaying())
+                                                     return false;
+                                             }
+                                             return true;
+                                         }),
+                          retiredKits.end());
     }
 
     void setSamplePath(const std::string &path) {
-        for (auto &source: audioSources) {
-            source->stop();
-            source->clearBuffer();
+        setKit(SampleKit::fromPath(path));
+    }
+
+    void setSampleData(const std::string &data) {
+        setKit(SampleKit::fromData(data));
+    }
+
+    /**
+     * Load the kit and activate it. The currently loaded kit stays active if loading fails.
+     *
+     * @param progress Invoked on the calling thread after every uploaded sample.
+     */
+    void setKit(const SampleKit &kit, const engine::AudioLoadProgress &progress = {}) {
+        setKit(loadKit(kit, loadOptions, progress));
+    }
+
+    /**
+     * Activate a kit created by loadKit.
+     *
+     * Following plays use the new kit while voices of the previous kit ring out,
+     * the previous kit is released by update once all of its voices have finished.
+     */
+    void setKit(std::unique_ptr<LoadedKit> loadedKit) {
+        if (kit)
+            retiredKits.emplace_back(std::move(kit));
+        kit = std::move(loadedKit);
+        update();
+    }
+
+    /**
+     * Decode every sample of the kit in parallel, upload them and create the voices for them.
+     *
+     * Does not touch the active kit, so it may run on another thread while the player is in use.
+     *
+     * @param progress Invoked on the calling thread after every uploaded sample.
+     * @param reuse Samples of a previously loaded kit by kit sample index, samples with a buffer are not loaded again
+     * and keep their voices.
+     */
+    std::unique_ptr<LoadedKit> loadKit(const SampleKit &kit,
+                                       const engine::AudioLoadOptions &options,
+                                       const engine::AudioLoadProgress &progress = {},
+                                       const std::vector<Sample> &reuse = {}) {
+        std::vector<engine::AudioLoadRequest> requests;
+        for (size_t i = 0; i < kit.samples.size(); i++) {
+            if (i < reuse.size() && reuse[i].buffer)
+                continue;
+            requests.emplace_back(getLoadRequest(kit.samples[i]));
+        }
+
+        auto ret = std::make_unique<LoadedKit>();
+        auto buffers = engine::loadAudioBuffers(requests, *audioContext, options, progress);
+        auto buffer = buffers.begin();
+        for (size_t i = 0; i < kit.samples.size(); i++) {
+            if (i < reuse.size() && reuse[i].buffer)
+                ret->samples.emplace_back(reuse[i]);
+            else
+                ret->samples.emplace_back(Sample{std::move(*buffer++), nullptr});
+        }
+
+        for (size_t piece = 0; piece < SampleKit::PIECE_COUNT; piece++) {
+            auto &layers = getLayers(kit, static_cast<SampleKit::Piece>(piece));
+            for (auto &layer: layers) {
+                if (layer.samples.empty())
+                    throw std::runtime_error("Kit layer without samples");
+                for (auto index: layer.samples) {
+                    if (index >= ret->samples.size())
+                        throw std::runtime_error("Invalid kit sample index " + std::to_string(index));
+                }
+            }
+            // Resolve every velocity step to the layer with the highest minimum velocity below it.
+            for (size_t step = 0; step < VELOCITY_STEPS; step++) {
+                float velocity = static_cast<float>(step) / (VELOCITY_STEPS - 1);
+                const SampleKit::Layer *selected = &layers.front();
+                for (auto &layer: layers) {
+                    if (layer.minimumVelocity <= velocity
+                        && (selected->minimumVelocity > velocity || layer.minimumVelocity > selected->minimumVelocity))
+                        selected = &layer;
+                }
+                auto slotIndex = static_cast<size_t>(selected - layers.data());
+                ret->layerTable[piece][step] = static_cast<uint16_t>(ret->layerSlots.size() + slotIndex);
+            }
+            for (auto &layer: layers) {
+                ret->layerSlots.emplace_back(Slot{layer.samples, 0});
+            }
         }
-        sourceIndex = 0;
-        audioSample = engine::loadAudioBuffer(path, *audioContext);
-        for (auto &source: audioSources) {
-            source->setBuffer(*audioSample);
+
+        for (auto &sample: ret->samples) {
+            if (!sample.voices) {
+                sample.voices = std::make_shared<VoicePool>(*audioContext,
+                                                            *sample.buffer,
+                                                            minimumVoices,
+                                                            maximumVoices,
+                                                            64,
+                                                            &voiceBudget);
+            }
         }
+        return ret;
     }
 
-    void setSampleData(const std::string &data) {
-        for (auto &source: audioSources) {
-            source->stop();
-            source->clearBuffer();
+    /**
+     * Load what follows the head of every partially loaded sample of a kit.
+     *
+     * The remainders are appended to the voices of their samples with VoicePool::append on the playing thread.
+     *
+     * @param samples The samples of the kit as loaded by loadKit with options.headDuration
+     * @param options The options the heads were loaded with and remainder set
+     * @return The remainders by kit sample index, null for samples which were loaded completely
+     */
+    std::vector<std::shared_ptr<engine::AudioBuffer>> loadRemainders(const SampleKit &kit,
+                                                                     const std::vector<Sample> &samples,
+                                                                     const engine::AudioLoadOptions &options) {
+        std::vector<engine::AudioLoadRequest> requests;
+        for (size_t i = 0; i < kit.samples.size() && i < samples.size(); i++) {
+            if (samples[i].buffer->getMetadata().partial)
+                requests.emplace_back(getLoadRequest(kit.samples[i]));
         }
-        sourceIndex = 0;
-        audioSample = engine::loadAudioBufferData(data, *audioContext);
-        for (auto &source: audioSources) {
-            source->setBuffer(*audioSample);
+
+        std::vector<std::shared_ptr<engine::AudioBuffer>> ret(samples.size());
+        auto buffers = engine::loadAudioBuffers(requests, *audioContext, options);
+        auto buffer = buffers.begin();
+        for (size_t i = 0; i < kit.samples.size() && i < samples.size(); i++) {
+            if (samples[i].buffer->getMetadata().partial)
+                ret[i] = std::move(*buffer++);
+        }
+        return ret;
+    }
+
+    /**
+     * Set the processing applied to samples loaded afterwards.
+     */
+    void setLoadOptions(const engine::AudioLoadOptions &options) {
+        loadOptions = options;
+    }
+
+    const engine::AudioLoadOptions &getLoadOptions() const {
+        return loadOptions;
+    }
+
+    /**
+     * @return The pre-roll before the transient onset of the sample which the next play of the piece triggers.
+     */
+    std::chrono::nanoseconds getOnset(SampleKit::Piece piece = SampleKit::BEAT, float velocity = 1) const {
+        if (!kit)
+            return std::chrono::nanoseconds(0);
+        auto &slot = kit->layerSlots[kit->layerTable[piece][quantizeVelocity(velocity)]];
+        auto onset = kit->samples[slot.alternates[slot.next]].buffer->getMetadata().onset;
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<float>(onset));
+    }
+
+    /**
+     * @return The context the samples are played on, for additional sources like streams.
+     */
+    engine::AudioContext &getContext() {
+        return *audioContext;
+    }
+
+    /**
+     * @return The measured output latency of the audio context.
+     */
+    std::chrono::nanoseconds getLatency() {
+        return audioContext->getLatency();
+    }
+
+    /**
+     * @return The voice statistics summed over the voice pools of all kit samples, except for peakActiveVoices
+     * which is the peak of the busiest sample.
+     */
+    VoicePool::Statistics getVoiceStatistics() const {
+        VoicePool::Statistics ret;
+        if (!kit)
+            return ret;
+        for (auto &sample: kit->samples) {
+            auto &stats = sample.voices->getStatistics();
+            ret.voices += stats.voices;
+            ret.activeVoices += stats.activeVoices;
+            ret.peakActiveVoices = std::max(ret.peakActiveVoices, stats.peakActiveVoices);
+            ret.triggers += stats.triggers;
+            ret.steals += stats.steals;
+            ret.drops += stats.drops;
+            ret.releases += stats.releases;
+            ret.grows += stats.grows;
+            ret.shrinks += stats.shrinks;
         }
+        return ret;
     }
 
 private:
+    /**
+     * Samples are converted to the output frequency at load time so the mixer does not resample every voice,
+     * the result is cached so that reloading a sample does not decode it again.
+     */
+    static engine::AudioLoadOptions defaultLoadOptions() {
+        engine::AudioLoadOptions ret;
+        ret.resample = true;
+        ret.cache = true;
+        return ret;
+    }
+
+    static engine::AudioLoadRequest getLoadRequest(const SampleKit::Sample &sample) {
+        engine::AudioLoadRequest ret;
+        if (!sample.path.empty()) {
+            ret.path = sample.path;
+        } else if (sample.memory != nullptr) {
+            ret.data = sample.memory;
+            ret.size = sample.memorySize;
+            ret.pcm = sample.pcm;
+        } else {
+            ret.data = sample.data.data();
+            ret.size = sample.data.size();
+        }
+        return ret;
+    }
+
+    static size_t quantizeVelocity(float velocity) {
+        if (!(velocity > 0))
+            return 0;
+        if (velocity >= 1)
+            return VELOCITY_STEPS - 1;
+        return static_cast<size_t>(velocity * (VELOCITY_STEPS - 1) + 0.5f);
+    }
+
+    /**
+     * Pieces without layers fall back to the beat layers or the first piece which defines layers.
+     */
+    static const std::vector<SampleKit::Layer> &getLayers(const SampleKit &kit, SampleKit::Piece piece) {
+        if (!kit.pieces[piece].empty())
+            return kit.pieces[piece];
+        if (!kit.pieces[SampleKit::BEAT].empty())
+            return kit.pieces[SampleKit::BEAT];
+        for (auto &layers: kit.pieces) {
+            if (!layers.empty())
+                return layers;
+        }
+        throw std::runtime_error("Kit does not define any layers");
+    }
+
     std::unique_ptr<engine::AudioDevice> audioDevice;
     std::unique_ptr<engine::AudioContext> audioContext;
-    std::unique_ptr<engine::AudioBuffer> audioSample;
 
-    int sourceIndex = 0;
-    std::vector<std::unique_ptr<engine::AudioSource>> audioSources;
+    engine::AudioLoadOptions loadOptions = defaultLoadOptions();
+
+    size_t minimumVoices;
+    size_t maximumVoices;
+    VoiceBudget voiceBudget{MAXIMUM_SOURCES}; // Outlives the kits
+    std::unique_ptr<LoadedKit> kit;
+    std::vector<std::unique_ptr<LoadedKit>> retiredKits; // Replaced kits with voices which may still be playing
 };
 
 #endif //METRONOME_SAMPLEPLAYER_HPP
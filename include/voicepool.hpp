@@ -0,0 +1,362 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef METRONOME_VOICEPOOL_HPP
+#define METRONOME_VOICEPOOL_HPP
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <atomic>
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+
+#include "audio/audiocontext.hpp"
+
+#include "waveform.hpp"
+
+/**
+ * The number of audio sources which the voice pools sharing it may allocate together,
+ * so that kits with many samples stay below the source limit of the driver.
+ */
+class VoiceBudget {
+public:
+    explicit VoiceBudget(size_t sources)
+            : available(static_cast<std::ptrdiff_t>(sources)) {}
+
+    /**
+     * @return False if no source is available.
+     */
+    bool acquire() {
+        if (available.fetch_sub(1) > 0)
+            return true;
+        available.fetch_add(1);
+        return false;
+    }
+
+    void release(size_t sources = 1) {
+        available.fetch_add(static_cast<std::ptrdiff_t>(sources));
+    }
+
+    bool isExhausted() const {
+        return available.load() <= 0;
+    }
+
+private:
+    std::atomic<std::ptrdiff_t> available;
+};
+
+/**
+ * A pool of audio sources bound to a single buffer.
+ *
+ * Triggers prefer voices which are not playing, grow the pool while all voices are busy and
+ * steal the quietest (and among equally loud ones the oldest) voice once the maximum is reached.
+ * The level of a voice is estimated from the waveform of the buffer at the playback position of the voice,
+ * voices of buffers without a waveform are considered equally loud and the oldest one is stolen.
+ * Voices which stay unused are released again down to the minimum pool size.
+ * A pool with a budget only grows while the budget has sources left and otherwise steals as if it were full.
+ * A pool which found the budget exhausted when it was created starts without voices and drops triggers
+ * until the budget has a source for it.
+ *
+ * When a trigger leaves every voice of a full pool playing, the next victim is faded out immediately
+ * by setting its gain to zero, which the mixer ramps over one update. The following trigger then
+ * reuses a silent voice instead of cutting off a sounding one, so retriggers stay click free
+ * without allocating additional sources.
+ *
+ * Voices of a partially loaded buffer queue it instead of binding it, so the remainder appended later
+ * continues playing voices without a gap.
+ */
+class VoicePool {
+public:
+    struct Statistics {
+        size_t voices = 0; // The current size of the pool
+        size_t activeVoices = 0; // The number of playing voices before the last trigger
+        size_t peakActiveVoices = 0; // The most voices playing at once, including the triggered one
+        size_t triggers = 0;
+        size_t steals = 0; // Triggers which had to cut off a sounding voice
+        size_t drops = 0; // Triggers which found no voice and no source left in the budget
+        size_t releases = 0; // Voices faded out ahead of being reused
+        size_t grows = 0;
+        size_t shrinks = 0;
+    };
+
+    /**
+     * @param minimumVoices The number of voices to preallocate, the pool never shrinks below this.
+     * @param maximumVoices The maximum number of concurrently playing samples.
+     * @param shrinkDelay The number of consecutive triggers with more than half of the pool idle before one voice is released.
+     * @param budget The budget shared with other pools which the voices are taken from, it has to outlive the pool.
+     * Voices are only preallocated while the budget allows.
+     */
+    VoicePool(engine::AudioContext &context,
+              const engine::AudioBuffer &buffer,
+              size_t minimumVoices,
+              size_t maximumVoices,
+              size_t shrinkDelay = 64,
+              VoiceBudget *budget = nullptr)
+            : context(context),
+              buffer(buffer),
+              minimumVoices(std::max<size_t>(minimumVoices, 1)),
+              maximumVoices(std::max(maximumVoices, std::max<size_t>(minimumVoices, 1))),
+              shrinkDelay(shrinkDelay),
+              budget(budget),
+              queued(buffer.getMetadata().partial) {
+        while (voices.size() < this->minimumVoices && reserveVoice()) {
+            addVoice();
+        }
+    }
+
+    ~VoicePool() {
+        stop();
+        if (budget)
+            budget->release(voices.size());
+    }
+
+    VoicePool(const VoicePool &) = delete;
+
+    VoicePool &operator=(const VoicePool &) = delete;
+
+    /**
+     * Start playback of the buffer on a voice selected by the allocation policy.
+     *
+     * @return The voice or null if the pool has no voice and the budget has no source left, the trigger is dropped.
+     */
+    engine::AudioSource *trigger() {
+        context.getSourceStates(sources, states);
+
+        size_t active = 0;
+        size_t freeIndex = voices.size();
+        for (size_t i = 0; i < voices.size(); i++) {
+            if (states[i] == engine::AudioSource::PLAYING) {
+                active++;
+            } else if (freeIndex == voices.size()
+                       || voices[i].lastTrigger < voices[freeIndex].lastTrigger) {
+                freeIndex = i;
+            }
+        }
+
+        statistics.triggers++;
+        statistics.activeVoices = active;
+        statistics.peakActiveVoices = std::max(statistics.peakActiveVoices, active + 1);
+
+        size_t index;
+        size_t playing = active + 1;
+        if (freeIndex < voices.size()) {
+            index = freeIndex;
+        } else if (voices.size() < maximumVoices && reserveVoice()) {
+            index = addVoice();
+            statistics.grows++;
+        } else if (voices.empty()) {
+            statistics.drops++;
+            return nullptr;
+        } else {
+            index = selectVictim(voices.size());
+            if (!voices[index].released)
+                statistics.steals++;
+            playing = active;
+        }
+
+        auto &voice = voices.at(index);
+        voice.lastTrigger = ++triggerCounter;
+        voice.source->stop();
+        if (voice.released) {
+            voice.source->setGain(gain);
+            voice.released = false;
+        }
+        voice.source->play();
+
+        if ((voices.size() >= maximumVoices || (budget && budget->isExhausted())) && playing >= voices.size()) {
+            releaseVoice(selectVictim(index));
+        }
+
+        updateShrink(playing);
+
+        return voice.source.get();
+    }
+
+    void stop() {
+        for (auto &voice: voices)
+            voice.source->stop();
+    }
+
+    /**
+     * @return True if any voice of the pool is still playing.
+     */
+    bool isPlaying() {
+        context.getSourceStates(sources, states);
+        return std::find(states.begin(), states.end(), engine::AudioSource::PLAYING) != states.end();
+    }
+
+    /**
+     * Queue a segment which continues the partially loaded buffer on every voice.
+     * Playing voices continue into it, a voice which reached the end of the buffer before has stopped there.
+     */
+    void append(std::shared_ptr<const engine::AudioBuffer> segment) {
+        if (!queued)
+            return;
+        for (auto &voice: voices)
+            voice.source->queueBuffers({*segment});
+        segments.emplace_back(std::move(segment));
+    }
+
+    const Statistics &getStatistics() const {
+        return statistics;
+    }
+
+    const engine::AudioBuffer &getBuffer() const {
+        return buffer;
+    }
+
+private:
+    struct Voice {
+        std::unique_ptr<engine::AudioSource> source;
+        uint64_t lastTrigger = 0;
+        bool released = false; // The gain was ramped to zero in preparation for reuse
+    };
+
+    /**
+     * @return True if the budget allows another voice, which is then taken from it.
+     */
+    bool reserveVoice() {
+        return !budget || budget->acquire();
+    }
+
+    size_t addVoice() {
+        Voice voice;
+        voice.source = context.createSource();
+        if (queued) {
+            std::vector<std::reference_wrapper<const engine::AudioBuffer>> buffers{buffer};
+            for (auto &segment: segments)
+                buffers.emplace_back(*segment);
+            voice.source->queueBuffers(buffers);
+        } else {
+            voice.source->setBuffer(buffer);
+        }
+        sources.emplace_back(*voice.source);
+        states.emplace_back(engine::AudioSource::INITIAL);
+        voices.emplace_back(std::move(voice));
+        statistics.voices = voices.size();
+        return voices.size() - 1;
+    }
+
+    /**
+     * @param exclude The index of a voice which should not be selected or voices.size()
+     */
+    size_t selectVictim(size_t exclude) {
+        context.getSourceOffsets(sources, offsets);
+
+        size_t ret = voices.size();
+        float victimLevel = 0;
+        for (size_t i = 0; i < voices.size(); i++) {
+            if (i == exclude)
+                continue;
+            auto level = estimateLevel(i);
+            if (ret == voices.size()
+                || level < victimLevel
+                || (level == victimLevel && voices[i].lastTrigger < voices[ret].lastTrigger)) {
+                ret = i;
+                victimLevel = level;
+            }
+        }
+        return ret;
+    }
+
+    /**
+     * @return The RMS level of the block of the waveform at the playback position of the voice, scaled by its gain.
+     */
+    float estimateLevel(size_t index) const {
+        auto &voice = voices[index];
+        if (voice.released)
+            return 0;
+
+        auto &metadata = buffer.getMetadata();
+        if (!metadata.waveform || !(metadata.duration > 0))
+            return gain;
+
+        auto frames = metadata.waveform->getFrameCount();
+        auto position = std::max(offsets[index], 0.0f) / metadata.duration;
+        auto frame = static_cast<size_t>(position * static_cast<float>(frames));
+        if (frame >= frames)
+            return 0;
+        auto bin = metadata.waveform->getBins(frame, frame + engine::Waveform::BLOCK_FRAMES, 1).front();
+        return gain * std::sqrt(bin.power);
+    }
+
+    void releaseVoice(size_t index) {
+        if (index >= voices.size() || voices[index].released)
+            return;
+        voices[index].source->setGain(0);
+        voices[index].released = true;
+        statistics.releases++;
+    }
+
+    void updateShrink(size_t active) {
+        if (voices.size() <= minimumVoices || active * 2 >= voices.size()) {
+            idleTriggers = 0;
+            return;
+        }
+
+        if (++idleTriggers < shrinkDelay)
+            return;
+
+        idleTriggers = 0;
+
+        // Release the least recently triggered voice which is not playing.
+        size_t index = voices.size();
+        for (size_t i = 0; i < voices.size(); i++) {
+            if (voices[i].lastTrigger == triggerCounter || states[i] == engine::AudioSource::PLAYING)
+                continue;
+            if (index == voices.size() || voices[i].lastTrigger < voices[index].lastTrigger)
+                index = i;
+        }
+        if (index == voices.size())
+            return;
+
+        voices.erase(voices.begin() + index);
+        sources.erase(sources.begin() + index);
+        states.erase(states.begin() + index);
+        if (budget)
+            budget->release();
+        statistics.voices = voices.size();
+        statistics.shrinks++;
+    }
+
+    engine::AudioContext &context;
+    const engine::AudioBuffer &buffer;
+
+    size_t minimumVoices;
+    size_t maximumVoices;
+    size_t shrinkDelay;
+    VoiceBudget *budget;
+    size_t idleTriggers = 0;
+    float gain = 1;
+    uint64_t triggerCounter = 0;
+    bool queued; // The buffer is partial and voices queue it followed by the appended segments
+
+    std::vector<std::shared_ptr<const engine::AudioBuffer>> segments; // Destroyed after the voices playing them
+    std::vector<Voice> voices;
+    std::vector<std::reference_wrapper<engine::AudioSource>> sources;
+    std::vector<engine::AudioSource::SourceState> states;
+    std::vector<float> offsets;
+
+    Statistics statistics;
+};
+
+#endif //METRONOME_VOICEPOOL_HPP
@@ -0,0 +1,90 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef METRONOME_WAVEFORM_HPP
+#define METRONOME_WAVEFORM_HPP
+
+#include <vector>
+
+#include <cstdint>
+#include <cstddef>
+
+namespace engine {
+    /**
+     * A min / max / RMS pyramid of a sample for drawing its waveform at any zoom level.
+     *
+     * The first level summarizes blocks of BLOCK_FRAMES frames over all channels and every following level
+     * merges pairs of bins of the previous one, so any range can be drawn from the level whose bins are
+     * just smaller than a pixel, touching at most a few bins per pixel.
+     */
+    class Waveform {
+    public:
+        static const size_t BLOCK_FRAMES = 64;
+
+        struct Bin {
+            float minimum = 0;
+            float maximum = 0;
+            float power = 0; // The mean square of the samples
+        };
+
+        Waveform() = default;
+
+        /**
+         * @param blocks The bins of consecutive blocks of BLOCK_FRAMES frames, the last block may be shorter.
+         * @param frames The number of frames the blocks summarize
+         */
+        Waveform(std::vector<Bin> blocks, size_t frames);
+
+        /**
+         * Scale the waveform by the non negative gain which was applied to the samples.
+         */
+        void scale(float gain);
+
+        /**
+         * Drop the first frames after they were trimmed from the samples.
+         */
+        void trim(size_t frames);
+
+        size_t getFrameCount() const {
+            return frames - offset;
+        }
+
+        /**
+         * Summarize the frames in [start, end) in count bins of equal length.
+         * The cost is proportional to count and independent of the length of the range.
+         */
+        std::vector<Bin> getBins(size_t start, size_t end, size_t count) const;
+
+        std::vector<uint8_t> serialize() const;
+
+        /**
+         * @return False if data does not contain a valid serialized waveform of the given size.
+         */
+        static bool deserialize(const void *data, size_t size, Waveform &waveform);
+
+    private:
+        void buildLevels();
+
+        size_t frames = 0;
+        size_t offset = 0; // The frames trimmed from the start of the blocks
+        std::vector<std::vector<Bin>> levels;
+    };
+}
+
+#endif //METRONOME_WAVEFORM_HPP
@@ -0,0 +1,44 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef METRONOME_ASSETS_HPP
+#define METRONOME_ASSETS_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Samples converted by the asset pipeline at build time and linked into the executable.
+ * Every asset is a pair of symbols marking the start and end of its PCM, see cmake/asset.cpp.in.
+ */
+extern "C" {
+extern const uint8_t asset_default_sample[];
+extern const uint8_t asset_default_sample_end[];
+}
+
+struct Asset {
+    const uint8_t *data;
+    size_t size;
+};
+
+inline Asset getDefaultSampleAsset() {
+    return Asset{asset_default_sample, static_cast<size_t>(asset_default_sample_end - asset_default_sample)};
+}
+
+#endif //METRONOME_ASSETS_HPP
@@ -18,6 +18,8 @@
  */
 
 #include <vector>
+#include <stdexcept>
+#include <string>
 
 #include "audio/openal/oalaudiobuffer.hpp"
 #include "audio/openal/oalcheckerror.hpp"
@@ -37,19 +39,75 @@ namespace engine {
                 return AL_FORMAT_BFORMAT2D_16;
             case BFORMAT3D_16:
                 return AL_FORMAT_BFORMAT3D_16;
+            case MONO_FLOAT32:
+                return AL_FORMAT_MONO_FLOAT32;
+            case STEREO_FLOAT32:
+                return AL_FORMAT_STEREO_FLOAT32;
+            case BFORMAT2D_FLOAT32:
+                return AL_FORMAT_BFORMAT2D_FLOAT32;
+            case BFORMAT3D_FLOAT32:
+                return AL_FORMAT_BFORMAT3D_FLOAT32;
         }
         throw std::runtime_error("Unrecognized format");
     }
 
-    OALAudioBuffer::OALAudioBuffer(ALuint handle) : handle(handle) {}
+    OALAudioBuffer::OALAudioBuffer(ALuint handle, LPALBUFFERSUBDATASOFT alBufferSubDataSOFT)
+            : handle(handle), alBufferSubDataSOFT(alBufferSubDataSOFT) {}
 
     OALAudioBuffer::~OALAudioBuffer() {
         alDeleteBuffers(1, &handle);
         checkOALError();
     }
 
-    void OALAudioBuffer::upload(const std::vector<uint8_t> &buffer, AudioFormat format, unsigned int frequency) {
-        alBufferData(handle, convertFormat(format), buffer.data(), buffer.size(), frequency);
+    void OALAudioBuffer::upload(const void *data, size_t size, AudioFormat format, unsigned int frequency) {
+        alBufferData(handle, convertFormat(format), data, static_cast<ALsizei>(size), static_cast<ALsizei>(frequency));
         checkOALError();
+
+        this->format = format;
+        this->frequency = frequency;
+        this->size = size;
+    }
+
+    void OALAudioBuffer::update(const void *data, size_t size, size_t offset, size_t length) {
+        if (size != this->size)
+            throw std::runtime_error("Buffer update does not match the uploaded size");
+        if (offset > size || length > size - offset)
+            throw std::runtime_error("Buffer update out of range");
+
+        auto frameSize = getChannelCount(format) * getSampleSize(format);
+        if (offset % frameSize != 0 || length % frameSize != 0)
+            throw std::runtime_error("Buffer update not aligned to frames");
+
+        if (length == 0)
+            return;
+
+        if (alBufferSubDataSOFT) {
+            alBufferSubDataSOFT(handle,
+                                convertFormat(format),
+                                static_cast<const uint8_t *>(data) + offset,
+                                static_cast<ALsizei>(offset),
+                                static_cast<ALsizei>(length));
+            checkOALError();
+        } else {
+            alBufferData(handle,
+                         convertFormat(format),
+                         data,
+                         static_cast<ALsizei>(size),
+                         static_cast<ALsizei>(frequency));
+            // OpenAL refuses to replace the data of a buffer which is attached to a source.
+            auto error = alGetError();
+            if (error == AL_INVALID_OPERATION)
+                throw std::runtime_error("Updating a buffer which is attached to a source requires AL_SOFT_buffer_sub_data");
+            if (error != AL_NO_ERROR)
+                throw std::runtime_error("OpenAL Error: " + std::to_string(error));
+        }
+    }
+
+    void OALAudioBuffer::setMetadata(const AudioMetadata &value) {
+        metadata = value;
+    }
+
+    const AudioMetadata &OALAudioBuffer::getMetadata() const {
+        return metadata;
     }
 }
\ No newline at end of file
@@ -29,11 +29,32 @@ namespace engine {
     public:
         const ALuint handle;
         
-        explicit OALAudioBuffer(ALuint handle);
+        /**
+         * @param alBufferSubDataSOFT The AL_SOFT_buffer_sub_data entry point or null if the extension is not available,
+         * in which case updates upload the complete contents again and throw while a source uses the buffer.
+         */
+        explicit OALAudioBuffer(ALuint handle, LPALBUFFERSUBDATASOFT alBufferSubDataSOFT = nullptr);
 
         ~OALAudioBuffer() override;
 
-        void upload(const std::vector<uint8_t> &buffer, AudioFormat format, unsigned int frequency) override;
+        using AudioBuffer::upload;
+
+        void upload(const void *data, size_t size, AudioFormat format, unsigned int frequency) override;
+
+        void update(const void *data, size_t size, size_t offset, size_t length) override;
+
+        void setMetadata(const AudioMetadata &value) override;
+
+        const AudioMetadata &getMetadata() const override;
+
+    private:
+        AudioMetadata metadata;
+
+        LPALBUFFERSUBDATASOFT alBufferSubDataSOFT;
+
+        AudioFormat format = MONO16;
+        unsigned int frequency = 0;
+        size_t size = 0;
     };
 }
 
@@ -24,7 +24,13 @@
 #include "audio/openal/oalcheckerror.hpp"
 
 namespace engine {
-    OALAudioContext::OALAudioContext(ALCcontext *context) : context(context), listener() {}
+    OALAudioContext::OALAudioContext(ALCcontext *context)
+            : context(context), device(alcGetContextsDevice(context)), listener() {
+        if (alcIsExtensionPresent(device, "ALC_SOFT_device_clock")) {
+            alcGetInteger64vSOFT = reinterpret_cast<LPALCGETINTEGER64VSOFT>(
+                    alcGetProcAddress(device, "alcGetInteger64vSOFT"));
+        }
+    }
 
     engine::OALAudioContext::~OALAudioContext() {
         if (alcGetCurrentContext() == context)
@@ -41,11 +47,64 @@ namespace engine {
         return listener;
     }
 
+    unsigned int OALAudioContext::getFrequency() {
+        ALCint ret = 0;
+        alcGetIntegerv(device, ALC_FREQUENCY, 1, &ret);
+        return static_cast<unsigned int>(ret);
+    }
+
+    unsigned int OALAudioContext::getRefreshRate() {
+        ALCint ret = 0;
+        alcGetIntegerv(device, ALC_REFRESH, 1, &ret);
+        return static_cast<unsigned int>(ret);
+    }
+
+    std::chrono::nanoseconds OALAudioContext::getLatency() {
+        if (alcGetInteger64vSOFT) {
+            ALCint64SOFT ret = 0;
+            alcGetInteger64vSOFT(device, ALC_DEVICE_LATENCY_SOFT, 1, &ret);
+            return std::chrono::nanoseconds(ret);
+        }
+        // Without the device clock extension assume that a started source is heard after one mixing update.
+        auto refresh = getRefreshRate();
+        if (refresh == 0)
+            return std::chrono::nanoseconds(0);
+        return std::chrono::nanoseconds(1000000000 / refresh);
+    }
+
+    bool OALAudioContext::isFormatSupported(AudioFormat format) {
+        switch (format) {
+            case MONO8:
+            case MONO16:
+            case STEREO8:
+            case STEREO16:
+                return true;
+            case BFORMAT2D_16:
+            case BFORMAT3D_16:
+                return alIsExtensionPresent("AL_EXT_BFORMAT");
+            case MONO_FLOAT32:
+            case STEREO_FLOAT32:
+                return alIsExtensionPresent("AL_EXT_float32");
+            case BFORMAT2D_FLOAT32:
+            case BFORMAT3D_FLOAT32:
+                return alIsExtensionPresent("AL_EXT_BFORMAT") && alIsExtensionPresent("AL_EXT_float32");
+        }
+        return false;
+    }
+
     std::unique_ptr<AudioBuffer> engine::OALAudioContext::createBuffer() {
         ALuint n;
         alGenBuffers(1, &n);
         checkOALError();
-        return std::make_unique<OALAudioBuffer>(n);
+        // AL extensions can only be queried with the context current, which creating a buffer requires anyway.
+        if (!bufferSubDataQueried) {
+            if (alIsExtensionPresent("AL_SOFT_buffer_sub_data")) {
+                alBufferSubDataSOFT = reinterpret_cast<LPALBUFFERSUBDATASOFT>(
+                        alGetProcAddress("alBufferSubDataSOFT"));
+            }
+            bufferSubDataQueried = true;
+        }
+        return std::make_unique<OALAudioBuffer>(n, alBufferSubDataSOFT);
     }
 
     std::unique_ptr<AudioSource> engine::OALAudioContext::createSource() {
@@ -55,6 +114,26 @@ namespace engine {
         return std::make_unique<OALAudioSource>(n);
     }
 
+    void OALAudioContext::getSourceStates(const std::vector<std::reference_wrapper<AudioSource>> &sources,
+                                          std::vector<AudioSource::SourceState> &states) {
+        states.resize(sources.size());
+        for (size_t i = 0; i < sources.size(); i++) {
+            ALint value = AL_INITIAL;
+            alGetSourcei(dynamic_cast<OALAudioSource &>(sources[i].get()).getHandle(), AL_SOURCE_STATE, &value);
+            states[i] = convertState(value);
+        }
+        checkOALError();
+    }
+
+    void OALAudioContext::getSourceOffsets(const std::vector<std::reference_wrapper<AudioSource>> &sources,
+                                           std::vector<float> &offsets) {
+        offsets.resize(sources.size());
+        for (size_t i = 0; i < sources.size(); i++) {
+            alGetSourcef(dynamic_cast<OALAudioSource &>(sources[i].get()).getHandle(), AL_SEC_OFFSET, &offsets[i]);
+        }
+        checkOALError();
+    }
+
     const ALCcontext *OALAudioContext::getContext() {
         return context;
     }
@@ -37,15 +37,34 @@ namespace engine {
 
         AudioListener &getListener() override;
 
+        unsigned int getFrequency() override;
+
+        unsigned int getRefreshRate() override;
+
+        std::chrono::nanoseconds getLatency() override;
+
+        bool isFormatSupported(AudioFormat format) override;
+
         std::unique_ptr<AudioBuffer> createBuffer() override;
 
         std::unique_ptr<AudioSource> createSource() override;
 
+        void getSourceStates(const std::vector<std::reference_wrapper<AudioSource>> &sources,
+                             std::vector<AudioSource::SourceState> &states) override;
+
+        void getSourceOffsets(const std::vector<std::reference_wrapper<AudioSource>> &sources,
+                              std::vector<float> &offsets) override;
+
         const ALCcontext *getContext();
 
     private:
         ALCcontext *context;
+        ALCdevice *device;
         OALAudioListener listener;
+
+        LPALCGETINTEGER64VSOFT alcGetInteger64vSOFT = nullptr; // ALC_SOFT_device_clock
+        LPALBUFFERSUBDATASOFT alBufferSubDataSOFT = nullptr; // AL_SOFT_buffer_sub_data
+        bool bufferSubDataQueried = false;
     };
 }
 
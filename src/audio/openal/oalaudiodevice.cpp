@@ -18,6 +18,7 @@
  */
 
 #include <stdexcept>
+#include <algorithm>
 
 #include "audio/openal/oalaudiocontext.hpp"
 #include "audio/openal/oalcheckerror.hpp"
@@ -64,7 +65,32 @@ namespace engine {
         alcCloseDevice(device);
     }
 
-    std::unique_ptr<AudioContext> OALAudioDevice::createContext() {
-        return std::make_unique<OALAudioContext>(alcCreateContext(device, nullptr));
+    std::unique_ptr<AudioContext> OALAudioDevice::createContext(const AudioContextConfig &config) {
+        ALCint frequency = static_cast<ALCint>(config.frequency);
+        if (frequency == 0) {
+            alcGetIntegerv(device, ALC_FREQUENCY, 1, &frequency);
+        }
+
+        ALCint refresh = static_cast<ALCint>(config.refreshRate);
+        if (config.periodSize > 0 && frequency > 0) {
+            refresh = std::max<ALCint>(frequency / static_cast<ALCint>(config.periodSize), 1);
+        }
+
+        std::vector<ALCint> attributes;
+        if (config.frequency > 0) {
+            attributes.emplace_back(ALC_FREQUENCY);
+            attributes.emplace_back(frequency);
+        }
+        if (refresh > 0) {
+            attributes.emplace_back(ALC_REFRESH);
+            attributes.emplace_back(refresh);
+        }
+        attributes.emplace_back(0);
+
+        auto *context = alcCreateContext(device, attributes.data());
+        if (!context) {
+            throw std::runtime_error("Failed to create context");
+        }
+        return std::make_unique<OALAudioContext>(context);
     }
 }
\ No newline at end of file
@@ -35,7 +35,7 @@ namespace engine {
 
         ~OALAudioDevice() override;
 
-        std::unique_ptr<AudioContext> createContext() override;
+        std::unique_ptr<AudioContext> createContext(const AudioContextConfig &config) override;
 
     private:
         ALCdevice *device;
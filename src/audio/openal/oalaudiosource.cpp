@@ -34,6 +34,21 @@ namespace engine {
         throw std::runtime_error("Unrecognized type");
     }
 
+    AudioSource::SourceState convertState(ALint state) {
+        switch (state) {
+            case AL_INITIAL:
+                return AudioSource::INITIAL;
+            case AL_PLAYING:
+                return AudioSource::PLAYING;
+            case AL_PAUSED:
+                return AudioSource::PAUSED;
+            case AL_STOPPED:
+                return AudioSource::STOPPED;
+            default:
+                throw std::runtime_error("Unknown state value");
+        }
+    }
+
     OALAudioSource::OALAudioSource(ALuint sourceHandle) : handle(sourceHandle) {}
 
     OALAudioSource::~OALAudioSource() {
@@ -62,242 +77,230 @@ namespace engine {
     }
 
     void OALAudioSource::setPitch(float pitch) {
+        if (this->pitch == pitch)
+            return;
         alSourcef(handle, AL_PITCH, pitch);
         checkOALError();
+        this->pitch = pitch;
     }
 
     float OALAudioSource::getPitch() {
-        float ret;
-        alGetSourcef(handle, AL_PITCH, &ret);
-        checkOALError();
-        return ret;
+        return pitch;
     }
 
     void OALAudioSource::setGain(float gain) {
+        if (this->gain == gain)
+            return;
         alSourcef(handle, AL_GAIN, gain);
         checkOALError();
+        this->gain = gain;
     }
 
     float OALAudioSource::getGain() {
-        float ret;
-        alGetSourcef(handle, AL_GAIN, &ret);
-        checkOALError();
-        return ret;
+        return gain;
     }
 
     void OALAudioSource::setMaxDistance(float maxDistance) {
+        if (this->maxDistance == maxDistance)
+            return;
         alSourcef(handle, AL_MAX_DISTANCE, maxDistance);
         checkOALError();
+        this->maxDistance = maxDistance;
     }
 
     float OALAudioSource::getMaxDistance() {
-        float ret;
-        alGetSourcef(handle, AL_MAX_DISTANCE, &ret);
-        checkOALError();
-        return ret;
+        return maxDistance;
     }
 
 
     void OALAudioSource::setRollOffFactor(float rollOffFactor) {
+        if (this->rollOffFactor == rollOffFactor)
+            return;
         alSourcef(handle, AL_ROLLOFF_FACTOR, rollOffFactor);
         checkOALError();
+        this->rollOffFactor = rollOffFactor;
     }
 
     float OALAudioSource::getRollOffFactor() {
-        float ret;
-        alGetSourcef(handle, AL_ROLLOFF_FACTOR, &ret);
-        checkOALError();
-        return ret;
+        return rollOffFactor;
     }
 
 
     void OALAudioSource::setReferenceDistance(float referenceDistance) {
+        if (this->referenceDistance == referenceDistance)
+            return;
         alSourcef(handle, AL_REFERENCE_DISTANCE, referenceDistance);
         checkOALError();
+        this->referenceDistance = referenceDistance;
     }
 
     float OALAudioSource::getReferenceDistance() {
-        float ret;
-        alGetSourcef(handle, AL_REFERENCE_DISTANCE, &ret);
-        checkOALError();
-        return ret;
+        return referenceDistance;
     }
 
     void OALAudioSource::setMininumGain(float minGain) {
+        if (minimumGain == minGain)
+            return;
         alSourcef(handle, AL_MIN_GAIN, minGain);
         checkOALError();
+        minimumGain = minGain;
     }
 
     float OALAudioSource::getMinimumGain() {
-        float ret;
-        alGetSourcef(handle, AL_MIN_GAIN, &ret);
-        checkOALError();
-        return ret;
+        return minimumGain;
     }
 
 
     void OALAudioSource::setMaximumGain(float maxGain) {
+        if (maximumGain == maxGain)
+            return;
         alSourcef(handle, AL_MAX_GAIN, maxGain);
         checkOALError();
+        maximumGain = maxGain;
     }
 
 
     float OALAudioSource::getMaximumGain() {
-        float ret;
-        alGetSourcef(handle, AL_MAX_GAIN, &ret);
-        checkOALError();
-        return ret;
+        return maximumGain;
     }
 
 
     void OALAudioSource::setConeOuterGain(float coneOuterGain) {
+        if (this->coneOuterGain == coneOuterGain)
+            return;
         alSourcef(handle, AL_CONE_OUTER_GAIN, coneOuterGain);
         checkOALError();
+        this->coneOuterGain = coneOuterGain;
     }
 
     float OALAudioSource::getConeOuterGain() {
-        float ret;
-        alGetSourcef(handle, AL_CONE_OUTER_GAIN, &ret);
-        checkOALError();
-        return ret;
+        return coneOuterGain;
     }
 
     void OALAudioSource::setConeInnerAngle(float innerAngle) {
+        if (coneInnerAngle == innerAngle)
+            return;
         alSourcef(handle, AL_CONE_INNER_ANGLE, innerAngle);
         checkOALError();
+        coneInnerAngle = innerAngle;
     }
 
     float OALAudioSource::getConeInnerAngle() {
-        float ret;
-        alGetSourcef(handle, AL_CONE_INNER_ANGLE, &ret);
-        checkOALError();
-        return ret;
+        return coneInnerAngle;
     }
 
 
     void OALAudioSource::setConeOuterAngle(float outerAngle) {
+        if (coneOuterAngle == outerAngle)
+            return;
         alSourcef(handle, AL_CONE_OUTER_ANGLE, outerAngle);
         checkOALError();
+        coneOuterAngle = outerAngle;
     }
 
 
     float OALAudioSource::getConeOuterAngle() {
-        float ret;
-        alGetSourcef(handle, AL_CONE_OUTER_ANGLE, &ret);
-        checkOALError();
-        return ret;
+        return coneOuterAngle;
     }
 
     void OALAudioSource::setPosition(Vec3f position) {
+        if (this->position == position)
+            return;
         alSource3f(handle, AL_POSITION, position.x, position.y, position.z);
         checkOALError();
+        this->position = position;
     }
 
     Vec3f OALAudioSource::getPosition() {
-        Vec3f ret;
-        alGetSource3f(handle, AL_POSITION, &ret.x, &ret.y, &ret.z);
-        checkOALError();
-        return ret;
+        return position;
     }
 
     void OALAudioSource::setVelocity(Vec3f velocity) {
+        if (this->velocity == velocity)
+            return;
         alSource3f(handle, AL_VELOCITY, velocity.x, velocity.y, velocity.z);
         checkOALError();
+        this->velocity = velocity;
     }
 
 
     Vec3f OALAudioSource::getVelocity() {
-        Vec3f ret;
-        alGetSource3f(handle, AL_VELOCITY, &ret.x, &ret.y, &ret.z);
-        checkOALError();
-        return ret;
+        return velocity;
     }
 
     void OALAudioSource::setDirection(Vec3f direction) {
+        if (this->direction == direction)
+            return;
         alSource3f(handle, AL_DIRECTION, direction.x, direction.y, direction.z);
         checkOALError();
+        this->direction = direction;
     }
 
     Vec3f OALAudioSource::getDirection() {
-        Vec3f ret;
-        alGetSource3f(handle, AL_DIRECTION, &ret.x, &ret.y, &ret.z);
-        checkOALError();
-        return ret;
+        return direction;
     }
 
 
     void OALAudioSource::setSourceRelative(bool relative) {
+        if (sourceRelative == relative)
+            return;
         alSourcei(handle, AL_SOURCE_RELATIVE, relative);
         checkOALError();
+        sourceRelative = relative;
     }
 
     bool OALAudioSource::getSourceRelative() {
-        int ret;
-        alGetSourcei(handle, AL_SOURCE_RELATIVE, &ret);
-        checkOALError();
-        return ret;
+        return sourceRelative;
     }
 
     void OALAudioSource::setSourceType(AudioSource::SourceType type) {
         alSourcei(handle, AL_SOURCE_TYPE, convertType(type));
         checkOALError();
+        sourceType = type;
     }
 
     AudioSource::SourceType OALAudioSource::getSourceType() {
-        int ret;
-        alGetSourcei(handle, AL_SOURCE_TYPE, &ret);
-        checkOALError();
-        switch (ret) {
-            case AL_UNDETERMINED:
-                return UNDETERMINED;
-            case AL_STATIC:
-                return STATIC;
-            case AL_STREAMING:
-                return STREAMING;
-            default:
-                throw std::runtime_error("Source type not recognized");
-        }
+        return sourceType;
     }
 
-    void OALAudioSource::setLooping(bool looping) {
-        alSourcei(handle, AL_LOOPING, looping);
+    void OALAudioSource::setLooping(bool value) {
+        if (looping == value)
+            return;
+        alSourcei(handle, AL_LOOPING, value);
         checkOALError();
+        looping = value;
     }
 
     bool OALAudioSource::getLooping() {
-        int ret;
-        alGetSourcei(handle, AL_LOOPING, &ret);
-        checkOALError();
-        return ret;
+        return looping;
     }
 
     AudioSource::SourceState OALAudioSource::getState() {
         ALint value = 0;
         alGetSourcei(handle, AL_SOURCE_STATE, &value);
         checkOALError();
-        switch (value) {
-            case AL_INITIAL:
-                return INITIAL;
-            case AL_PLAYING:
-                return PLAYING;
-            case AL_PAUSED:
-                return PAUSED;
-            case AL_STOPPED:
-                return STOPPED;
-            default:
-                throw std::runtime_error("Unknown state value");
-        }
+        return convertState(value);
+    }
+
+    float OALAudioSource::getOffset() {
+        float ret;
+        alGetSourcef(handle, AL_SEC_OFFSET, &ret);
+        checkOALError();
+        return ret;
     }
 
     void OALAudioSource::setBuffer(const AudioBuffer &buffer) {
         auto &b = dynamic_cast<const OALAudioBuffer &>(buffer);
         alSourcei(handle, AL_BUFFER, b.handle);
         checkOALError();
+        sourceType = STATIC;
     }
 
     void OALAudioSource::clearBuffer() {
         alSourcei(handle, AL_BUFFER, 0);
         checkOALError();
+        sourceType = UNDETERMINED;
+        bufferMapping.clear();
     }
 
     void OALAudioSource::queueBuffers(std::vector<std::reference_wrapper<const AudioBuffer>> buffers) {
@@ -310,6 +313,7 @@ namespace engine {
         }
         alSourceQueueBuffers(handle, buffers.size(), b);
         checkOALError();
+        sourceType = STREAMING;
     }
 
     std::vector<std::reference_wrapper<const AudioBuffer>> OALAudioSource::unqueueBuffers() {
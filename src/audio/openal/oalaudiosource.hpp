@@ -22,8 +22,11 @@
 #include "audio/audiosource.hpp"
 
 #include <map>
+#include <cfloat>
 
 namespace engine {
+    AudioSource::SourceState convertState(ALint state);
+
     class OALAudioSource : public AudioSource {
     public:
         explicit OALAudioSource(ALuint sourceHandle);
@@ -104,6 +107,8 @@ namespace engine {
 
         SourceState getState() override;
 
+        float getOffset() override;
+
         void setBuffer(const AudioBuffer &buffer) override;
 
         void clearBuffer() override;
@@ -118,5 +123,23 @@ namespace engine {
         ALuint handle;
 
         std::map<ALuint, std::reference_wrapper<const AudioBuffer>> bufferMapping; //Mapping for returning unqueued buffers.
+
+        // Mirror of the settable source properties, initialized to the OpenAL defaults.
+        float pitch = 1;
+        float gain = 1;
+        float maxDistance = FLT_MAX;
+        float rollOffFactor = 1;
+        float referenceDistance = 1;
+        float minimumGain = 0;
+        float maximumGain = 1;
+        float coneOuterGain = 0;
+        float coneInnerAngle = 360;
+        float coneOuterAngle = 360;
+        Vec3f position;
+        Vec3f velocity;
+        Vec3f direction;
+        bool sourceRelative = false;
+        bool looping = false;
+        SourceType sourceType = UNDETERMINED;
     };
 }
\ No newline at end of file
@@ -18,6 +18,17 @@
  */
 
 #include "audioloader.hpp"
+#include "mappedfile.hpp"
+#include "scratcharena.hpp"
+#include "samplecache.hpp"
+#include "threadpool.hpp"
+#include "pcmheader.hpp"
+#include "downmix.hpp"
+#include "waveform.hpp"
+
+#include "dsp/convert.hpp"
+#include "dsp/resampler.hpp"
+#include "dsp/analysis.hpp"
 
 #include <string>
 #include <sndfile.h>
@@ -26,37 +37,94 @@
 #include <limits>
 #include <cstring>
 #include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <cmath>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <cerrno>
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace engine {
+    /**
+     * Decoded PCM ready for upload, pointing either into the scratch arena or into the source data.
+     */
     class Audio {
     public:
-        std::vector<uint8_t> buffer;
+        const uint8_t *data = nullptr;
+        size_t size = 0;
         AudioFormat format;
         unsigned int frequency;
+        bool writable = false; // The data lives in the scratch arena and may be processed in place
+        bool convertToInt16 = false; // The float data is converted to 16 bit after the analysis
+        bool analyzed = false; // A segment load measured the whole sample and selected the segment already
+        size_t skipFrames = 0; // Head frames a remainder load keeps until the complete sample was cached
+        AudioMetadata metadata;
+        SF_INFO source{}; // The file as libsndfile opened it, zero for cached and prepared PCM data
     };
 
+    // The window and hop size of the short-term loudness measurement in seconds.
+    static const float LOUDNESS_WINDOW = 0.4f;
+    static const size_t LOUDNESS_HOPS = 4;
+
+    // Incremented when the stored processing results change so that older cache entries are not reused.
+    static const uint8_t CACHE_REVISION = 1;
+
+    // Scratch buffers larger than this are released after a load instead of being kept for the next one.
+    static const size_t MAXIMUM_RETAINED_SCRATCH = 16 * 1024 * 1024;
+
+    static ScratchArena &getScratchArena() {
+        static thread_local ScratchArena arena;
+        return arena;
+    }
+
+    /**
+     * Non-owning view of encoded audio data in memory.
+     */
     struct LibSndBuffer {
-        std::string data;
-        size_t pos;
+        const uint8_t *data;
+        sf_count_t size;
+        sf_count_t pos;
     };
 
     sf_count_t sf_vio_get_filelen(void *user_data) {
         auto *buffer = reinterpret_cast<LibSndBuffer *>(user_data);
-        return static_cast<sf_count_t>(buffer->data.size());
+        return buffer->size;
     }
 
     sf_count_t sf_vio_seek(sf_count_t offset, int whence, void *user_data) {
         auto *buffer = reinterpret_cast<LibSndBuffer *>(user_data);
-        buffer->pos = offset;
-        return static_cast<sf_count_t >(buffer->pos);
+        sf_count_t base;
+        switch (whence) {
+            case SEEK_SET:
+                base = 0;
+                break;
+            case SEEK_CUR:
+                base = buffer->pos;
+                break;
+            case SEEK_END:
+                base = buffer->size;
+                break;
+            default:
+                return -1;
+        }
+        sf_count_t pos = base + offset;
+        if (pos < 0 || pos > buffer->size)
+            return -1;
+        buffer->pos = pos;
+        return buffer->pos;
     }
 
     sf_count_t sf_vio_read(void *ptr, sf_count_t count, void *user_data) {
         auto *buffer = reinterpret_cast<LibSndBuffer *>(user_data);
-        sf_count_t ret;
-        for (ret = 0; ret < count && buffer->pos + ret < buffer->data.size(); ret++) {
-            static_cast<char *>(ptr)[ret] = buffer->data.at(buffer->pos + ret);
-        }
+        sf_count_t ret = std::max<sf_count_t>(std::min(count, buffer->size - buffer->pos), 0);
+        std::memcpy(ptr, buffer->data + buffer->pos, static_cast<size_t>(ret));
         buffer->pos += ret;
         return ret;
     }
@@ -70,64 +138,749 @@ namespace engine {
         return static_cast<sf_count_t >(buffer->pos);
     }
 
-    static Audio processSndFile(SNDFILE *sndfile, const SF_INFO &sfinfo) {
-        if (sfinfo.frames<1
-                          || sfinfo.frames>(sf_count_t)(std::numeric_limits<int>::max() / sizeof(short)) /
-            sfinfo.channels) {
+    /**
+     * The properties of the target context, queried once per load.
+     */
+    struct LoadTarget {
+        bool float32 = false;
+        bool bformatFloat32 = false;
+        unsigned int frequency = 0;
+    };
+
+    static LoadTarget getLoadTarget(AudioContext &context) {
+        LoadTarget ret;
+        ret.frequency = context.getFrequency();
+        ret.float32 = context.isFormatSupported(MONO_FLOAT32) && context.isFormatSupported(STEREO_FLOAT32);
+        ret.bformatFloat32 = context.isFormatSupported(BFORMAT2D_FLOAT32)
+                             && context.isFormatSupported(BFORMAT3D_FLOAT32);
+        return ret;
+    }
+
+    /**
+     * @return True if the encoding carries more than 16 bits of resolution.
+     */
+    static bool isHighResolution(int format) {
+        switch (format & SF_FORMAT_SUBMASK) {
+            case SF_FORMAT_PCM_24:
+            case SF_FORMAT_PCM_32:
+            case SF_FORMAT_FLOAT:
+            case SF_FORMAT_DOUBLE:
+            case SF_FORMAT_VORBIS:
+            case SF_FORMAT_ALAC_24:
+            case SF_FORMAT_ALAC_32:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    static bool needsResampling(unsigned int frequency, const LoadTarget &target, const AudioLoadOptions &options) {
+        return options.resample && target.frequency > 0 && target.frequency != frequency;
+    }
+
+    /**
+     * Convert interleaved frames to the target frequency.
+     *
+     * @return The resampled frames, allocated from the scratch arena
+     */
+    static float *resample(const float *samples,
+                           size_t &frames,
+                           size_t channels,
+                           const Resampler &resampler,
+                           ScratchArena &scratch) {
+        auto padding = resampler.getPadding();
+        auto planeSize = frames + padding * 2;
+
+        std::vector<float *> planes(channels);
+        for (size_t c = 0; c < channels; c++) {
+            auto *plane = scratch.allocate<float>(planeSize);
+            std::fill(plane, plane + padding, 0.0f);
+            std::fill(plane + padding + frames, plane + planeSize, 0.0f);
+            planes[c] = plane + padding;
+        }
+        deinterleave(samples, planes.data(), channels, frames);
+
+        auto outputFrames = resampler.getOutputFrames(frames);
+        auto *ret = scratch.allocate<float>(outputFrames * channels);
+        for (size_t c = 0; c < channels; c++) {
+            resampler.process(planes[c], frames, ret + c, channels);
+        }
+        frames = outputFrames;
+        return ret;
+    }
+
+    /**
+     * Measures the peak and short-term loudness and builds the waveform blocks of interleaved samples passed in order.
+     *
+     * The loudness is the highest mean square level summed over the channels of any window of
+     * LOUDNESS_WINDOW seconds, advanced in steps of a quarter window. No frequency weighting is applied.
+     */
+    class LevelMeter {
+    public:
+        /**
+         * @param samples The expected number of samples, used to reserve the waveform blocks
+         */
+        LevelMeter(size_t channels, unsigned int frequency, size_t samples)
+                : channels(channels),
+                  hopSize(std::max<size_t>(static_cast<size_t>(LOUDNESS_WINDOW / LOUDNESS_HOPS * frequency), 1)
+                          * channels),
+                  blockSize(Waveform::BLOCK_FRAMES * channels) {
+            blocks.reserve(samples / blockSize + 1);
+        }
+
+        /**
+         * @return The peak of the passed samples
+         */
+        float add(const float *samples, size_t count) {
+            float ret = 0;
+            added += count;
+            while (count > 0) {
+                auto length = std::min(count, std::min(hopSize - hopFill, blockSize - blockFill));
+                auto level = measureLevel(samples, length);
+                ret = std::max(ret, level.peak);
+                hops[hopIndex] += level.energy;
+                hopFill += length;
+                if (hopFill == hopSize)
+                    finishHop();
+                block.minimum = blockFill == 0 ? level.minimum : std::min(block.minimum, level.minimum);
+                block.maximum = blockFill == 0 ? level.maximum : std::max(block.maximum, level.maximum);
+                blockEnergy += level.energy;
+                blockFill += length;
+                if (blockFill == blockSize)
+                    finishBlock();
+                samples += length;
+                count -= length;
+            }
+            peak = std::max(peak, ret);
+            return ret;
+        }
+
+        /**
+         * Store the peak and loudness of all passed samples in metadata and their waveform in waveform.
+         */
+        void finish(AudioMetadata &metadata, Waveform &waveform) {
+            if (hopFill > 0)
+                finishHop();
+            if (blockFill > 0)
+                finishBlock();
+            waveform = Waveform(std::move(blocks), added / channels);
+
+            metadata.peak = peak;
+            auto windowFrames = static_cast<double>(hopSize / channels * LOUDNESS_HOPS);
+            metadata.loudness = maximumEnergy > 0
+                                ? static_cast<float>(10 * std::log10(maximumEnergy / windowFrames))
+                                : -std::numeric_limits<float>::infinity();
+        }
+
+    private:
+        void finishBlock() {
+            block.power = static_cast<float>(blockEnergy / static_cast<double>(blockFill));
+            blocks.emplace_back(block);
+            blockEnergy = 0;
+            blockFill = 0;
+        }
+
+        void finishHop() {
+            double energy = 0;
+            for (auto hop: hops)
+                energy += hop;
+            maximumEnergy = std::max(maximumEnergy, energy);
+            hopIndex = (hopIndex + 1) % LOUDNESS_HOPS;
+            hops[hopIndex] = 0;
+            hopFill = 0;
+        }
+
+        size_t channels;
+        size_t hopSize;
+        size_t blockSize;
+        size_t added = 0;
+
+        std::vector<Waveform::Bin> blocks;
+        Waveform::Bin block;
+        double blockEnergy = 0;
+        size_t blockFill = 0;
+
+        float peak = 0;
+        double hops[LOUDNESS_HOPS] = {};
+        size_t hopIndex = 0;
+        size_t hopFill = 0;
+        double maximumEnergy = 0;
+    };
+
+    /**
+     * Finds the transient onset of samples passed in order without keeping them.
+     *
+     * The onset is the first sample reaching a fraction of the final peak, such a sample is louder than all samples
+     * before it. Only these running maxima are kept and the ones below the fraction of the current peak are dropped.
+     */
+    class OnsetTracker {
+    public:
+        explicit OnsetTracker(float threshold)
+                : threshold(threshold) {}
+
+        /**
+         * @param blockPeak The peak of the passed samples
+         */
+        void add(const float *samples, size_t count, float blockPeak) {
+            if (blockPeak > peak) {
+                for (size_t i = 0; i < count; i++) {
+                    auto magnitude = std::abs(samples[i]);
+                    if (magnitude > peak) {
+                        peak = magnitude;
+                        maxima.emplace_back(position + i, magnitude);
+                    }
+                }
+                while (!maxima.empty() && maxima.front().second < peak * threshold)
+                    maxima.pop_front();
+            }
+            position += count;
+        }
+
+        /**
+         * @return The index of the first sample at the onset
+         */
+        size_t getOnset() const {
+            return maxima.empty() ? 0 : maxima.front().first;
+        }
+
+    private:
+        float threshold;
+        float peak = 0;
+        size_t position = 0;
+        std::deque<std::pair<size_t, float>> maxima;
+    };
+
+    /**
+     * Measure the whole sample in blocks which are discarded after their analysis and rewind the file.
+     * The measurement is taken after mixing down and before resampling.
+     *
+     * @param frames Receives the number of frames which were read
+     * @return The index of the frame at the onset
+     */
+    static size_t measureSndFile(SNDFILE *sndfile,
+                                 const SF_INFO &sfinfo,
+                                 const std::vector<float> &downmix,
+                                 const AudioLoadOptions &options,
+                                 ScratchArena &scratch,
+                                 AudioMetadata &metadata,
+                                 Waveform &waveform,
+                                 size_t &frames) {
+        static const size_t BLOCK_FRAMES = 4096;
+
+        auto channels = static_cast<size_t>(sfinfo.channels);
+        auto measuredChannels = downmix.empty() ? channels : 2;
+        auto *block = scratch.allocate<float>(BLOCK_FRAMES * channels);
+        auto *mixed = downmix.empty() ? block : scratch.allocate<float>(BLOCK_FRAMES * 2);
+
+        LevelMeter meter(measuredChannels, sfinfo.samplerate, static_cast<size_t>(sfinfo.frames) * measuredChannels);
+        OnsetTracker onset(options.onsetThreshold);
+        frames = 0;
+        sf_count_t count;
+        while ((count = sf_readf_float(sndfile, block, BLOCK_FRAMES)) > 0) {
+            auto length = static_cast<size_t>(count);
+            if (!downmix.empty())
+                mixChannels(block, channels, mixed, 2, downmix.data(), length);
+            auto blockPeak = meter.add(mixed, length * measuredChannels);
+            onset.add(mixed, length * measuredChannels, blockPeak);
+            frames += length;
+        }
+        if (frames < 1 || sf_seek(sndfile, 0, SEEK_SET) != 0) {
             sf_close(sndfile);
-            throw std::runtime_error("Bad sample count in audio buffer");
+            throw std::runtime_error("Failed to read samples from audio data");
         }
 
-        Audio ret;
+        meter.finish(metadata, waveform);
+        return onset.getOnset() / measuredChannels;
+    }
 
+    /**
+     * The part of a processed sample which a segment load returns, in frames at the output frequency.
+     */
+    struct Segment {
+        size_t onset = 0; // The onset before trimming
+        size_t trim = 0; // The pre-roll which is trimmed
+        size_t head = 0; // The length of the head after the trimmed pre-roll
+        size_t frames = 0; // The length of the whole sample before trimming
+    };
+
+    static Segment getSegment(size_t onset, size_t frames, unsigned int frequency, const AudioLoadOptions &options) {
+        Segment ret;
+        ret.onset = onset;
+        ret.frames = frames;
+        if (options.trimSilence) {
+            auto margin = static_cast<size_t>(std::max(options.onsetMargin, 0.0f) * frequency);
+            ret.trim = onset - std::min(margin, onset);
+        }
+        ret.head = std::max<size_t>(static_cast<size_t>(std::ceil(options.headDuration * static_cast<float>(frequency))),
+                                    1);
+        return ret;
+    }
+
+    /**
+     * Narrow audio, which starts at the first frame of the sample, to the segment requested in options.
+     * The metadata already holds the peak and loudness of the whole sample, the remaining fields are
+     * taken from the segment and the waveform of the whole sample.
+     */
+    static void selectSegment(Audio &audio, const Segment &segment, const AudioLoadOptions &options, Waveform waveform) {
+        auto frameSize = getChannelCount(audio.format) * getSampleSize(audio.format);
+        auto available = audio.size / frameSize;
+        auto end = options.remainder ? available : std::min(segment.trim + segment.head, available);
+        if (end <= segment.trim + (options.remainder ? segment.head : 0))
+            throw std::runtime_error(options.remainder ? "No remainder after the head segment" : "Empty head segment");
+
+        audio.data += segment.trim * frameSize;
+        audio.size = (end - segment.trim) * frameSize;
+        if (options.remainder)
+            audio.skipFrames = segment.head;
+
+        // The waveform was measured before resampling, so its frames are scaled rather than counted.
+        waveform.trim(segment.trim * waveform.getFrameCount() / segment.frames);
+
+        auto frequency = static_cast<float>(audio.frequency);
+        audio.metadata.onset = static_cast<float>(segment.onset - segment.trim) / frequency;
+        audio.metadata.duration = static_cast<float>(segment.frames - segment.trim) / frequency;
+        audio.metadata.partial = !options.remainder && end < segment.frames;
+        audio.metadata.waveform = std::make_shared<const Waveform>(std::move(waveform));
+        audio.analyzed = true;
+    }
+
+    /**
+     * Decode a source which needs neither resampling nor mixing straight to 16 bit.
+     */
+    static Audio readSndFileInt16(SNDFILE *sndfile,
+                                  const SF_INFO &sfinfo,
+                                  bool ambisonic,
+                                  sf_count_t loadFrames,
+                                  ScratchArena &scratch) {
+        Audio ret;
         if (sfinfo.channels == 1) {
             ret.format = MONO16;
         } else if (sfinfo.channels == 2) {
             ret.format = STEREO16;
-        } else if (sfinfo.channels == 3) {
-            if (sf_command(sndfile, SFC_WAVEX_GET_AMBISONIC, NULL, 0) == SF_AMBISONIC_B_FORMAT) {
-                ret.format = BFORMAT2D_16;
-            } else {
-                sf_close(sndfile);
-                throw std::runtime_error("Unsupported channel count: " + std::to_string(sfinfo.channels));
-            }
-        } else if (sfinfo.channels == 4) {
-            if (sf_command(sndfile, SFC_WAVEX_GET_AMBISONIC, NULL, 0) == SF_AMBISONIC_B_FORMAT) {
-                ret.format = BFORMAT3D_16;
-            } else {
-                sf_close(sndfile);
-                throw std::runtime_error("Unsupported channel count: " + std::to_string(sfinfo.channels));
-            }
+        } else if (sfinfo.channels == 3 && ambisonic) {
+            ret.format = BFORMAT2D_16;
+        } else if (sfinfo.channels == 4 && ambisonic) {
+            ret.format = BFORMAT3D_16;
         } else {
             sf_close(sndfile);
             throw std::runtime_error("Unsupported channel count: " + std::to_string(sfinfo.channels));
         }
 
+        auto *buff = scratch.allocate<int16_t>(static_cast<size_t>(loadFrames * sfinfo.channels));
+
+        sf_count_t num_frames = sf_readf_short(sndfile, buff, loadFrames);
+        sf_close(sndfile);
+        if (num_frames < 1)
+            throw std::runtime_error("Failed to read samples from audio data");
+
         ret.frequency = sfinfo.samplerate;
+        ret.data = reinterpret_cast<const uint8_t *>(buff);
+        ret.size = static_cast<size_t>(num_frames * sfinfo.channels) * sizeof(int16_t);
+        ret.writable = true;
+        return ret;
+    }
 
-        auto *buff = static_cast<short *>(malloc((size_t) (sfinfo.frames * sfinfo.channels) * sizeof(short)));
+    /**
+     * Decode as floats, mixing down and resampling if requested.
+     *
+     * @param resampler Null if the source keeps its frequency
+     */
+    static Audio readSndFileFloat(SNDFILE *sndfile,
+                                  const SF_INFO &sfinfo,
+                                  bool ambisonic,
+                                  const std::vector<float> &downmix,
+                                  const Resampler *resampler,
+                                  unsigned int frequency,
+                                  sf_count_t loadFrames,
+                                  ScratchArena &scratch) {
+        Audio ret;
+        if (sfinfo.channels == 1) {
+            ret.format = MONO_FLOAT32;
+        } else if (sfinfo.channels == 2 || !downmix.empty()) {
+            ret.format = STEREO_FLOAT32;
+        } else if (sfinfo.channels == 3 && ambisonic) {
+            ret.format = BFORMAT2D_FLOAT32;
+        } else if (sfinfo.channels == 4 && ambisonic) {
+            ret.format = BFORMAT3D_FLOAT32;
+        } else {
+            sf_close(sndfile);
+            throw std::runtime_error("Unsupported channel count: " + std::to_string(sfinfo.channels));
+        }
+
+        auto *buff = scratch.allocate<float>(static_cast<size_t>(loadFrames * sfinfo.channels));
 
-        sf_count_t num_frames = sf_readf_short(sndfile, buff, sfinfo.frames);
+        sf_count_t num_frames = sf_readf_float(sndfile, buff, loadFrames);
         if (num_frames < 1) {
-            free(buff);
             sf_close(sndfile);
             throw std::runtime_error("Failed to read samples from audio data");
         }
 
-        sf_count_t num_bytes = num_frames * sfinfo.channels * sizeof(short);
+        sf_close(sndfile);
 
-        ret.buffer.resize(num_bytes);
+        auto frames = static_cast<size_t>(num_frames);
+        auto channels = static_cast<size_t>(sfinfo.channels);
 
-        std::memcpy(ret.buffer.data(), buff, num_bytes);
+        if (!downmix.empty()) {
+            auto *mixed = scratch.allocate<float>(frames * 2);
+            mixChannels(buff, channels, mixed, 2, downmix.data(), frames);
+            buff = mixed;
+            channels = 2;
+        }
 
-        free(buff);
+        if (resampler)
+            buff = resample(buff, frames, channels, *resampler, scratch);
 
-        sf_close(sndfile);
+        ret.frequency = frequency;
+        ret.data = reinterpret_cast<const uint8_t *>(buff);
+        ret.size = frames * channels * sizeof(float);
+        ret.writable = true;
+        return ret;
+    }
+
+    /**
+     * Decode into the scratch arena and resample or mix down if requested.
+     * Sources which end up as 16 bit without resampling or mixing are decoded to 16 bit directly, all others as floats.
+     * Float data is marked for conversion to 16 bit unless the source has a higher resolution and the context accepts float data.
+     *
+     * Segment loads measure the whole sample first and then decode only the source frames their segment needs,
+     * a head is decoded with enough frames after it for the resampler to produce the same output as for the whole sample.
+     */
+    static Audio processSndFile(SNDFILE *sndfile,
+                                const SF_INFO &sfinfo,
+                                const LoadTarget &output,
+                                const AudioLoadOptions &options,
+                                ScratchArena &scratch) {
+        if (sfinfo.frames<1
+                          || sfinfo.frames>(sf_count_t)(std::numeric_limits<int>::max() / sizeof(float)) /
+            sfinfo.channels) {
+            sf_close(sndfile);
+            throw std::runtime_error("Bad sample count in audio buffer");
+        }
 
+        bool ambisonic = false;
+        if (sfinfo.channels == 3 || sfinfo.channels == 4) {
+            ambisonic = sf_command(sndfile, SFC_WAVEX_GET_AMBISONIC, NULL, 0) == SF_AMBISONIC_B_FORMAT;
+        }
+
+        bool useFloat = isHighResolution(sfinfo.format) && (ambisonic ? output.bformatFloat32 : output.float32);
+
+        // Other layouts are mixed down to stereo once here, so voices never play more than two channels.
+        std::vector<float> downmix;
+        if (sfinfo.channels > 2 && !ambisonic)
+            downmix = getStereoDownmix(sndfile, sfinfo.channels);
+
+        std::unique_ptr<Resampler> resampler;
+        unsigned int frequency = sfinfo.samplerate;
+        if (needsResampling(sfinfo.samplerate, output, options)) {
+            resampler = std::make_unique<Resampler>(sfinfo.samplerate, output.frequency);
+            frequency = output.frequency;
+        }
+
+        bool segmented = options.headDuration > 0;
+        auto loadFrames = sfinfo.frames;
+        AudioMetadata analysis;
+        Waveform waveform;
+        Segment segment;
+        if (segmented) {
+            size_t sourceFrames;
+            auto onset = measureSndFile(sndfile, sfinfo, downmix, options, scratch, analysis, waveform, sourceFrames);
+            auto rate = static_cast<uint64_t>(sfinfo.samplerate);
+            segment = getSegment(static_cast<size_t>(onset * static_cast<uint64_t>(frequency) / rate),
+                                 resampler ? resampler->getOutputFrames(sourceFrames) : sourceFrames,
+                                 frequency,
+                                 options);
+            if (!options.remainder) {
+                auto end = static_cast<uint64_t>(std::min(segment.trim + segment.head, segment.frames));
+                auto needed = resampler ? (end * rate + frequency - 1) / frequency + resampler->getPadding() : end;
+                loadFrames = std::min(loadFrames, static_cast<sf_count_t>(needed));
+            }
+        }
+
+        // Float data would only be converted back after the analysis, so 16 bit results skip it to halve the scratch memory.
+        Audio ret;
+        if (!useFloat && downmix.empty() && !resampler) {
+            ret = readSndFileInt16(sndfile, sfinfo, ambisonic, loadFrames, scratch);
+        } else {
+            ret = readSndFileFloat(sndfile, sfinfo, ambisonic, downmix, resampler.get(), frequency, loadFrames, scratch);
+            ret.convertToInt16 = !useFloat;
+        }
+
+        if (segmented) {
+            ret.metadata = analysis;
+            selectSegment(ret, segment, options, std::move(waveform));
+        }
         return ret;
     }
 
-    static Audio readAudio(const std::string &buf) {
+    static uint32_t readLE32(const uint8_t *data) {
+        return static_cast<uint32_t>(data[0])
+               | static_cast<uint32_t>(data[1]) << 8
+               | static_cast<uint32_t>(data[2]) << 16
+               | static_cast<uint32_t>(data[3]) << 24;
+    }
+
+    /**
+     * Locate the sample data of a RIFF WAVE file.
+     *
+     * @return False if the data chunk could not be found.
+     */
+    static bool findWaveData(const uint8_t *data, size_t size, size_t &offset, size_t &length) {
+        if (size < 12 || std::memcmp(data, "RIFF", 4) != 0 || std::memcmp(data + 8, "WAVE", 4) != 0)
+            return false;
+        size_t pos = 12;
+        while (pos + 8 <= size) {
+            size_t chunkSize = readLE32(data + pos + 4);
+            if (std::memcmp(data + pos, "data", 4) == 0) {
+                offset = pos + 8;
+                length = std::min(chunkSize, size - offset);
+                return true;
+            }
+            pos += 8 + chunkSize + (chunkSize & 1);
+        }
+        return false;
+    }
+
+    /**
+     * Uncompressed mono or stereo WAV files in a format OpenAL accepts are copied without decoding.
+     *
+     * @return False if the data has to be decoded.
+     */
+    static bool readUncompressedAudio(const uint8_t *data,
+                                      size_t size,
+                                      const SF_INFO &sfinfo,
+                                      Audio &audio) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        int type = sfinfo.format & SF_FORMAT_TYPEMASK;
+        int subtype = sfinfo.format & SF_FORMAT_SUBMASK;
+        int endian = sfinfo.format & SF_FORMAT_ENDMASK;
+        if ((type != SF_FORMAT_WAV && type != SF_FORMAT_WAVEX)
+            || (endian != SF_ENDIAN_FILE && endian != SF_ENDIAN_LITTLE)
+            || (sfinfo.channels != 1 && sfinfo.channels != 2))
+            return false;
+
+        size_t sampleSize;
+        if (subtype == SF_FORMAT_PCM_16) {
+            sampleSize = 2;
+            audio.format = sfinfo.channels == 1 ? MONO16 : STEREO16;
+        } else if (subtype == SF_FORMAT_PCM_U8) {
+            sampleSize = 1;
+            audio.format = sfinfo.channels == 1 ? MONO8 : STEREO8;
+        } else {
+            return false;
+        }
+
+        size_t offset, length;
+        if (!findWaveData(data, size, offset, length))
+            return false;
+
+        size_t frameSize = sampleSize * sfinfo.channels;
+        size_t frames = length / frameSize;
+        if (frames < 1)
+            return false;
+
+        audio.frequency = sfinfo.samplerate;
+        audio.data = data + offset;
+        audio.size = frames * frameSize;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    static AudioFormat getInt16Format(AudioFormat format) {
+        switch (format) {
+            case MONO8:
+            case MONO_FLOAT32:
+                return MONO16;
+            case STEREO8:
+            case STEREO_FLOAT32:
+                return STEREO16;
+            case BFORMAT2D_FLOAT32:
+                return BFORMAT2D_16;
+            case BFORMAT3D_FLOAT32:
+                return BFORMAT3D_16;
+            default:
+                return format;
+        }
+    }
+
+    /**
+     * Invoke callback with consecutive blocks of the samples starting at the given sample index converted to float.
+     * Float data is passed through directly, integer data is converted into a small buffer which stays in cache.
+     * The callback returns false to stop the iteration.
+     */
+    template<typename T>
+    static void forEachBlock(const Audio &audio, size_t begin, T callback) {
+        static const size_t BLOCK_SIZE = 1024;
+
+        auto sampleSize = getSampleSize(audio.format);
+        auto count = audio.size / sampleSize;
+        if (sampleSize == 4) {
+            auto *samples = reinterpret_cast<const float *>(audio.data);
+            if (begin < count)
+                callback(samples + begin, begin, count - begin);
+            return;
+        }
+
+        alignas(64) float block[BLOCK_SIZE];
+        for (size_t pos = begin; pos < count; pos += BLOCK_SIZE) {
+            auto length = std::min(BLOCK_SIZE, count - pos);
+            if (sampleSize == 2) {
+                convertInt16ToFloat(reinterpret_cast<const int16_t *>(audio.data) + pos, block, length);
+            } else {
+                for (size_t i = 0; i < length; i++)
+                    block[i] = (static_cast<float>(audio.data[pos + i]) - 128.0f) / 128.0f;
+            }
+            if (!callback(block, pos, length))
+                return;
+        }
+    }
+
+    /**
+     * Measure the peak and short-term loudness and build the waveform blocks in one pass and detect the transient onset.
+     *
+     * @return The index of the first sample at the onset
+     */
+    static size_t measureAudio(Audio &audio, const AudioLoadOptions &options, Waveform &waveform) {
+        LevelMeter meter(getChannelCount(audio.format), audio.frequency, audio.size / getSampleSize(audio.format));
+        forEachBlock(audio, 0, [&meter](const float *samples, size_t, size_t count) {
+            meter.add(samples, count);
+            return true;
+        });
+        meter.finish(audio.metadata, waveform);
+
+        auto peak = audio.metadata.peak;
+        if (!(peak > 0))
+            return 0;
+
+        auto threshold = peak * options.onsetThreshold;
+        size_t onset = 0;
+        forEachBlock(audio, 0, [&onset, threshold](const float *samples, size_t offset, size_t count) {
+            auto index = findFirstAbove(samples, count, threshold);
+            if (index == count)
+                return true;
+            onset = offset + index;
+            return false;
+        });
+        return onset;
+    }
+
+    /**
+     * Multiply the audio by gain, integer data is converted to 16 bit in the process.
+     */
+    static void normalizeAudio(Audio &audio, float gain, ScratchArena &scratch) {
+        auto count = audio.size / getSampleSize(audio.format);
+
+        audio.metadata.peak *= gain;
+        audio.metadata.loudness += 20 * std::log10(gain);
+        audio.metadata.gain = gain;
+
+        // Decoded 16 bit data is scaled in place through a small block instead of a float copy.
+        if (audio.writable && getSampleSize(audio.format) == 2) {
+            static const size_t BLOCK_SIZE = 1024;
+            alignas(64) float block[BLOCK_SIZE];
+            auto *data = reinterpret_cast<int16_t *>(const_cast<uint8_t *>(audio.data));
+            for (size_t pos = 0; pos < count; pos += BLOCK_SIZE) {
+                auto length = std::min(BLOCK_SIZE, count - pos);
+                convertInt16ToFloat(data + pos, block, length);
+                applyGain(block, length, gain);
+                convertFloatToInt16(block, data + pos, length);
+            }
+            return;
+        }
+
+        float *samples;
+        if (audio.writable && getSampleSize(audio.format) == 4) {
+            samples = reinterpret_cast<float *>(const_cast<uint8_t *>(audio.data));
+        } else {
+            samples = scratch.allocate<float>(count);
+            forEachBlock(audio, 0, [samples](const float *block, size_t offset, size_t length) {
+                std::memcpy(samples + offset, block, length * sizeof(float));
+                return true;
+            });
+        }
+
+        applyGain(samples, count, gain);
+
+        if (getSampleSize(audio.format) == 4) {
+            audio.size = count * sizeof(float);
+        } else {
+            convertFloatToInt16(samples, reinterpret_cast<int16_t *>(samples), count);
+            audio.format = getInt16Format(audio.format);
+            audio.size = count * sizeof(int16_t);
+        }
+        audio.data = reinterpret_cast<const uint8_t *>(samples);
+        audio.writable = true;
+    }
+
+    /**
+     * Analyze the audio, record or trim the pre-roll before the onset and apply the normalization and
+     * format conversion requested in options.
+     */
+    static void processAudio(Audio &audio, const AudioLoadOptions &options, ScratchArena &scratch) {
+        Waveform waveform;
+        if (audio.analyzed) {
+            // The gain below then follows from the whole sample, so heads and remainders match.
+            waveform = *audio.metadata.waveform;
+        } else {
+            auto onset = measureAudio(audio, options, waveform);
+
+            auto channels = getChannelCount(audio.format);
+            auto frameSize = channels * getSampleSize(audio.format);
+            auto onsetFrame = onset / channels;
+
+            if (options.trimSilence) {
+                auto margin = static_cast<size_t>(std::max(options.onsetMargin, 0.0f) * audio.frequency);
+                auto trim = onsetFrame - std::min(margin, onsetFrame);
+                audio.data += trim * frameSize;
+                audio.size -= trim * frameSize;
+                onsetFrame -= trim;
+                waveform.trim(trim);
+            }
+
+            audio.metadata.onset = static_cast<float>(onsetFrame) / static_cast<float>(audio.frequency);
+        }
+
+        if (options.normalize && audio.metadata.peak > 0) {
+            auto gain = std::pow(10.0f, (options.targetLoudness - audio.metadata.loudness) / 20);
+            gain = std::min(gain, 1 / audio.metadata.peak);
+            if (std::abs(gain - 1) > 0.001f) {
+                normalizeAudio(audio, gain, scratch);
+                waveform.scale(gain);
+            }
+        }
+
+        audio.metadata.waveform = std::make_shared<const Waveform>(std::move(waveform));
+
+        if (audio.convertToInt16) {
+            auto count = audio.size / sizeof(float);
+            auto *samples = reinterpret_cast<float *>(const_cast<uint8_t *>(audio.data));
+            convertFloatToInt16(samples, reinterpret_cast<int16_t *>(samples), count);
+            audio.format = getInt16Format(audio.format);
+            audio.size = count * sizeof(int16_t);
+            audio.convertToInt16 = false;
+        }
+    }
+
+    /**
+     * Drop the head frames which a remainder load kept for processing and caching the complete sample.
+     */
+    static void skipHead(Audio &audio) {
+        auto skip = audio.skipFrames * getChannelCount(audio.format) * getSampleSize(audio.format);
+        audio.data += skip;
+        audio.size -= skip;
+        audio.skipFrames = 0;
+    }
+
+    /**
+     * @param name The name of the data used in error messages
+     */
+    static Audio readAudio(const void *data,
+                           size_t size,
+                           const LoadTarget &output,
+                           const AudioLoadOptions &options,
+                           ScratchArena &scratch,
+                           const std::string &name = "buffer") {
         SF_VIRTUAL_IO virtio;
         virtio.get_filelen = &sf_vio_get_filelen;
         virtio.seek = &sf_vio_seek;
@@ -135,37 +888,408 @@ namespace engine {
         virtio.write = &sf_vio_write;
         virtio.tell = &sf_vio_tell;
 
-        LibSndBuffer buffer{buf, 0};
+        LibSndBuffer buffer{static_cast<const uint8_t *>(data), static_cast<sf_count_t>(size), 0};
         SF_INFO sfinfo;
         SNDFILE *sndfile = sf_open_virtual(&virtio, SFM_READ, &sfinfo, &buffer);
         if (!sndfile) {
             auto err = sf_strerror(sndfile);
-            throw std::runtime_error("Failed to open audio buffer\nError:" + std::string(err));
+            throw std::runtime_error("Failed to open audio " + name + "\nError: " + std::string(err));
+        }
+        Audio ret;
+        if (!needsResampling(sfinfo.samplerate, output, options)
+            && readUncompressedAudio(buffer.data, size, sfinfo, ret)) {
+            sf_close(sndfile);
+            ret.source = sfinfo;
+            // The samples are in memory already, so segment loads measure them directly.
+            if (options.headDuration > 0) {
+                Waveform waveform;
+                auto channels = getChannelCount(ret.format);
+                auto onset = measureAudio(ret, options, waveform) / channels;
+                auto frames = ret.size / (channels * getSampleSize(ret.format));
+                selectSegment(ret, getSegment(onset, frames, ret.frequency, options), options, std::move(waveform));
+            }
+            return ret;
+        }
+        ret = processSndFile(sndfile, sfinfo, output, options, scratch);
+        ret.source = sfinfo;
+        return ret;
+    }
+
+    static std::unique_ptr<AudioBuffer> upload(const Audio &audio, AudioContext &context) {
+        if (audio.size > static_cast<size_t>(std::numeric_limits<int>::max()))
+            throw std::runtime_error("Audio data too large");
+        auto ret = context.createBuffer();
+        ret->upload(audio.data, audio.size, audio.format, audio.frequency);
+        auto metadata = audio.metadata;
+        if (!(metadata.duration > 0)) {
+            auto frames = audio.size / (getChannelCount(audio.format) * getSampleSize(audio.format));
+            metadata.duration = static_cast<float>(frames) / static_cast<float>(audio.frequency);
+        }
+        ret->setMetadata(metadata);
+        return ret;
+    }
+
+    static SampleCache &getSampleCache() {
+        static SampleCache cache;
+        return cache;
+    }
+
+    /**
+     * @return The cache key of the encoded data processed for the given target and options.
+     */
+    static uint64_t getCacheKey(const void *data,
+                                size_t size,
+                                const LoadTarget &output,
+                                const AudioLoadOptions &options) {
+        struct {
+            uint32_t frequency;
+            uint8_t float32;
+            uint8_t bformatFloat32;
+            uint8_t resample;
+            uint8_t trimSilence;
+            uint8_t normalize;
+            uint8_t revision; // Invalidates entries written by older versions of the processing
+            float onsetThreshold;
+            float onsetMargin;
+            float targetLoudness;
+        } parameters;
+        // Zero the padding so that it does not change the hash.
+        std::memset(&parameters, 0, sizeof(parameters));
+        parameters.frequency = output.frequency;
+        parameters.float32 = output.float32;
+        parameters.bformatFloat32 = output.bformatFloat32;
+        parameters.resample = options.resample;
+        parameters.trimSilence = options.trimSilence;
+        parameters.normalize = options.normalize;
+        parameters.revision = CACHE_REVISION;
+        parameters.onsetThreshold = options.onsetThreshold;
+        parameters.onsetMargin = options.onsetMargin;
+        parameters.targetLoudness = options.targetLoudness;
+        return SampleCache::hash(data, size, SampleCache::hash(&parameters, sizeof(parameters)));
+    }
+
+    static ThreadPool &getThreadPool() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    /**
+     * The memory which decoded audio may point into, it has to stay alive until the audio is uploaded.
+     */
+    struct DecodeStorage {
+        std::unique_ptr<MappedFile> file;
+        SampleCache::Entry entry;
+    };
+
+    /**
+     * Decode and process the encoded data or take the result from the sample cache.
+     *
+     * @param name The name of the data used in error messages
+     */
+    static Audio decodeEncoded(const void *data,
+                               size_t size,
+                               const LoadTarget &output,
+                               const AudioLoadOptions &options,
+                               ScratchArena &scratch,
+                               DecodeStorage &storage,
+                               const std::string &name = "buffer") {
+        uint64_t key = 0;
+        if (options.cache) {
+            key = getCacheKey(data, size, output, options);
+            auto &entry = storage.entry;
+            // A remainder is only requested after its head load missed the cache.
+            if (!options.remainder && getSampleCache().load(key, entry)) {
+                Audio audio;
+                audio.data = entry.data;
+                audio.size = entry.size;
+                audio.format = entry.format;
+                audio.frequency = entry.frequency;
+                audio.metadata = entry.metadata;
+                return audio;
+            }
+        }
+
+        auto audio = readAudio(data, size, output, options, scratch, name);
+        processAudio(audio, options, scratch);
+        // Data which still points into the encoded source was not decoded and gains nothing from caching.
+        // A head segment is keyed like the whole sample, so only complete samples are stored and a cached
+        // sample is returned whole even if only the head was requested. A remainder still holds its head here.
+        if (options.cache && audio.writable && !audio.metadata.partial) {
+            getSampleCache().store(key, audio.data, audio.size, audio.format, audio.frequency, audio.metadata);
         }
-        return processSndFile(sndfile, sfinfo);
+        skipHead(audio);
+        return audio;
     }
 
-    static Audio readAudioFile(const std::string &path) {
+    /**
+     * Read a whole regular file into the scratch arena, used instead of a mapping for files which may be truncated
+     * while they are loaded.
+     *
+     * @return Null if the file is not a regular file.
+     */
+    static const uint8_t *readFile(const std::string &path, ScratchArena &scratch, size_t &size) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return nullptr;
+
+        struct stat st{};
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+            close(fd);
+            return nullptr;
+        }
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        auto capacity = static_cast<size_t>(st.st_size);
+        auto *ret = scratch.allocate<uint8_t>(capacity);
+        size = 0;
+        // A file which shrinks while it is read is loaded as far as it goes, appended data is ignored.
+        while (size < capacity) {
+            auto count = read(fd, ret + size, capacity - size);
+            if (count < 0) {
+                if (errno == EINTR)
+                    continue;
+                auto error = errno;
+                close(fd);
+                throw std::runtime_error("Failed to read file at " + path + "\nError: " + std::strerror(error));
+            }
+            if (count == 0)
+                break;
+            size += static_cast<size_t>(count);
+        }
+        close(fd);
+        return ret;
+    }
+
+    static Audio decodeFile(const std::string &path,
+                            const LoadTarget &output,
+                            const AudioLoadOptions &options,
+                            ScratchArena &scratch,
+                            DecodeStorage &storage) {
+        if (options.readFiles) {
+            size_t size = 0;
+            auto *data = readFile(path, scratch, size);
+            if (data) {
+                return decodeEncoded(data, size, output, options, scratch, storage, "file at " + path);
+            }
+        } else {
+            try {
+                storage.file = std::make_unique<MappedFile>(path);
+            } catch (const std::exception &) {
+                // Not a mappable file, handled below.
+            }
+            if (storage.file) {
+                auto &file = *storage.file;
+                return decodeEncoded(file.data(), file.size(), output, options, scratch, storage, "file at " + path);
+            }
+        }
+
+        // Not a regular file, let libsndfile report a meaningful error or use its own IO.
         SF_INFO sfinfo;
         SNDFILE *sndfile = sf_open(path.c_str(), SFM_READ, &sfinfo);
         if (!sndfile) {
             auto err = sf_strerror(sndfile);
             throw std::runtime_error("Failed to open audio file at " + path + "\nError: " + std::string(err));
         }
-        return processSndFile(sndfile, sfinfo);
+        auto audio = processSndFile(sndfile, sfinfo, output, options, scratch);
+        audio.source = sfinfo;
+        processAudio(audio, options, scratch);
+        skipHead(audio);
+        return audio;
     }
 
-    std::unique_ptr<AudioBuffer> loadAudioBuffer(const std::string &path, AudioContext &context) {
-        auto audio = readAudioFile(path);
-        auto ret = context.createBuffer();
-        ret->upload(audio.buffer, audio.format, audio.frequency);
-        return std::move(ret);
+    /**
+     * Reference PCM with a PcmHeader in place.
+     */
+    static Audio readPcm(const void *data, size_t size) {
+        PcmHeader header{};
+        if (!PcmHeader::read(data, size, header))
+            throw std::runtime_error("Invalid PCM data");
+        Audio ret;
+        ret.data = static_cast<const uint8_t *>(data) + sizeof(PcmHeader);
+        ret.size = static_cast<size_t>(header.size);
+        ret.format = static_cast<AudioFormat>(header.format);
+        ret.frequency = header.frequency;
+        ret.metadata = header.getMetadata(data);
+        return ret;
     }
 
-    std::unique_ptr<AudioBuffer> loadAudioBufferData(const std::string &data, AudioContext &context) {
-        auto audio = readAudio(data);
-        auto ret = context.createBuffer();
-        ret->upload(audio.buffer, audio.format, audio.frequency);
-        return std::move(ret);
+    /**
+     * A load of a batch in flight, recycled for later requests of the batch to reuse the scratch memory.
+     */
+    struct DecodeJob {
+        size_t index = 0;
+        ScratchArena scratch;
+        DecodeStorage storage;
+        Audio audio;
+        std::exception_ptr error;
+    };
+
+    std::unique_ptr<AudioBuffer> loadAudioBuffer(const std::string &path,
+                                                 AudioContext &context,
+                                                 const AudioLoadOptions &options) {
+        auto output = getLoadTarget(context);
+        auto &scratch = getScratchArena();
+        scratch.reset(MAXIMUM_RETAINED_SCRATCH);
+        DecodeStorage storage;
+        return upload(decodeFile(path, output, options, scratch, storage), context);
+    }
+
+    std::unique_ptr<AudioBuffer> loadAudioBufferData(const std::string &data,
+                                                     AudioContext &context,
+                                                     const AudioLoadOptions &options) {
+        return loadAudioBufferData(data.data(), data.size(), context, options);
+    }
+
+    std::unique_ptr<AudioBuffer> loadAudioBufferData(const void *data,
+                                                     size_t size,
+                                                     AudioContext &context,
+                                                     const AudioLoadOptions &options) {
+        auto output = getLoadTarget(context);
+        auto &scratch = getScratchArena();
+        scratch.reset(MAXIMUM_RETAINED_SCRATCH);
+        DecodeStorage storage;
+        return upload(decodeEncoded(data, size, output, options, scratch, storage), context);
+    }
+
+    std::unique_ptr<AudioBuffer> loadAudioBufferPcm(const void *data, size_t size, AudioContext &context) {
+        return upload(readPcm(data, size), context);
+    }
+
+    DecodedAudio decodeAudioFile(const std::string &path, unsigned int frequency, const AudioLoadOptions &options) {
+        LoadTarget output;
+        output.frequency = frequency;
+        ScratchArena scratch;
+        DecodeStorage storage;
+        auto audio = decodeFile(path, output, options, scratch, storage);
+        DecodedAudio ret;
+        ret.data.assign(audio.data, audio.data + audio.size);
+        ret.format = audio.format;
+        ret.frequency = audio.frequency;
+        ret.metadata = audio.metadata;
+        ret.sourceFormat = audio.source.format;
+        ret.sourceChannels = audio.source.channels;
+        ret.sourceFrequency = static_cast<unsigned int>(audio.source.samplerate);
+        ret.sourceFrames = audio.source.frames;
+        return ret;
+    }
+
+    std::vector<std::unique_ptr<AudioBuffer>> loadAudioBuffers(const std::vector<AudioLoadRequest> &requests,
+                                                               AudioContext &context,
+                                                               const AudioLoadOptions &options,
+                                                               const AudioLoadProgress &progress) {
+        std::vector<std::unique_ptr<AudioBuffer>> ret(requests.size());
+        if (requests.empty())
+            return ret;
+
+        auto output = getLoadTarget(context);
+        auto &pool = getThreadPool();
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<std::unique_ptr<DecodeJob>> finished;
+        std::vector<std::unique_ptr<DecodeJob>> idle;
+        std::atomic<bool> cancelled{false};
+
+        size_t submitted = 0;
+        size_t completed = 0;
+
+        // Every submitted job references the locals of this function, so all of them have to finish before it
+        // returns, also when submitting or uploading throws.
+        struct JobGuard {
+            std::mutex &mutex;
+            std::condition_variable &condition;
+            const std::deque<std::unique_ptr<DecodeJob>> &finished;
+            const size_t &submitted;
+            const size_t &completed;
+
+            ~JobGuard() {
+                std::unique_lock<std::mutex> guard(mutex);
+                condition.wait(guard, [this]() { return completed + finished.size() >= submitted; });
+            }
+        } jobGuard{mutex, condition, finished, submitted, completed};
+
+        auto submit = [&]() {
+            std::unique_ptr<DecodeJob> job;
+            if (idle.empty()) {
+                job = std::make_unique<DecodeJob>();
+            } else {
+                job = std::move(idle.back());
+                idle.pop_back();
+            }
+            job->index = submitted;
+            auto *pointer = job.get();
+            pool.submit([&, pointer]() {
+                std::unique_ptr<DecodeJob> job(pointer);
+                if (!cancelled) {
+                    try {
+                        auto &request = requests[job->index];
+                        if (request.pcm)
+                            job->audio = readPcm(request.data, request.size);
+                        else if (!request.path.empty())
+                            job->audio = decodeFile(request.path, output, options, job->scratch, job->storage);
+                        else
+                            job->audio = decodeEncoded(request.data,
+                                                       request.size,
+                                                       output,
+                                                       options,
+                                                       job->scratch,
+                                                       job->storage);
+                    } catch (...) {
+                        job->error = std::current_exception();
+                    }
+                }
+                std::lock_guard<std::mutex> guard(mutex);
+                finished.emplace_back(std::move(job));
+                condition.notify_one();
+            });
+            // The job owns itself once it is queued.
+            job.release();
+            submitted++;
+        };
+
+        // Limit the number of decoded samples waiting for their upload to bound the memory usage.
+        auto inFlight = std::min(requests.size(), pool.getThreadCount() * 2);
+        while (submitted < inFlight)
+            submit();
+
+        // Errors are collected instead of thrown so that the remaining jobs are not left running.
+        std::exception_ptr error;
+        while (completed < submitted) {
+            std::unique_ptr<DecodeJob> job;
+            {
+                std::unique_lock<std::mutex> guard(mutex);
+                condition.wait(guard, [&finished]() { return !finished.empty(); });
+                job = std::move(finished.front());
+                finished.pop_front();
+            }
+            completed++;
+
+            if (!error) {
+                try {
+                    if (job->error)
+                        std::rethrow_exception(job->error);
+                    ret[job->index] = upload(job->audio, context);
+                    if (progress)
+                        progress(completed, requests.size());
+                } catch (...) {
+                    error = std::current_exception();
+                    cancelled = true;
+                }
+            }
+
+            job->storage = DecodeStorage();
+            job->scratch.reset(MAXIMUM_RETAINED_SCRATCH);
+            job->audio = Audio();
+            job->error = nullptr;
+            idle.emplace_back(std::move(job));
+
+            if (!error && submitted < requests.size())
+                submit();
+        }
+
+        if (error)
+            std::rethrow_exception(error);
+
+        return ret;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,292 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "audiostream.hpp"
+#include "ringbuffer.hpp"
+#include "downmix.hpp"
+
+#include "dsp/convert.hpp"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+
+#include <sndfile.h>
+
+namespace engine {
+    static const size_t CHUNK_FRAMES = 4096;
+    static const size_t RING_CHUNKS = 16; // The read ahead of the decoder
+    static const size_t QUEUED_BUFFERS = 4; // The chunks queued on the source
+
+    struct Chunk {
+        uint64_t generation = 0;
+        uint64_t start = 0; // The stream position of the first frame
+        size_t frames = 0;
+        std::vector<float> samples;
+    };
+
+    struct AudioStream::Decoder {
+        SNDFILE *sndfile = nullptr;
+        SF_INFO sfinfo{};
+
+        RingBuffer<Chunk> ring;
+
+        // Files with more than two channels are mixed down to stereo while decoding.
+        std::vector<float> downmix;
+        std::vector<float> input;
+
+        std::atomic<uint64_t> generation{0};
+        std::atomic<uint64_t> seekFrame{0};
+        std::atomic<bool> looping{false};
+        std::atomic<bool> running{true};
+
+        // Wakes the thread when the ring has space again or a seek was requested.
+        std::mutex mutex;
+        std::condition_variable condition;
+
+        std::thread thread;
+
+        Decoder(SNDFILE *sndfile, const SF_INFO &sfinfo, std::vector<float> downmix)
+                : sndfile(sndfile),
+                  sfinfo(sfinfo),
+                  ring(RING_CHUNKS, Chunk{0, 0, 0, std::vector<float>(CHUNK_FRAMES * std::min(sfinfo.channels, 2))}),
+                  downmix(std::move(downmix)) {
+            if (!this->downmix.empty())
+                input.resize(CHUNK_FRAMES * sfinfo.channels);
+            thread = std::thread([this]() { run(); });
+        }
+
+        ~Decoder() {
+            running = false;
+            wake();
+            thread.join();
+            sf_close(sndfile);
+        }
+
+        void wake() {
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+            }
+            condition.notify_one();
+        }
+
+        void run() {
+            uint64_t current = generation.load(std::memory_order_acquire);
+            uint64_t position = 0;
+            bool atEnd = false;
+            while (running) {
+                auto requested = generation.load(std::memory_order_acquire);
+                if (requested != current) {
+                    current = requested;
+                    position = seekFrame.load();
+                    atEnd = sf_seek(sndfile, static_cast<sf_count_t>(position), SEEK_SET) < 0;
+                }
+
+                Chunk *chunk = atEnd ? nullptr : ring.beginWrite();
+                if (chunk == nullptr) {
+                    std::unique_lock<std::mutex> guard(mutex);
+                    condition.wait(guard, [&]() {
+                        return !running
+                               || generation.load(std::memory_order_acquire) != current
+                               || (!atEnd && !ring.isFull());
+                    });
+                    continue;
+                }
+
+                sf_count_t read;
+                if (downmix.empty()) {
+                    read = sf_readf_float(sndfile, chunk->samples.data(), CHUNK_FRAMES);
+                } else {
+                    read = sf_readf_float(sndfile, input.data(), CHUNK_FRAMES);
+                    if (read > 0) {
+                        mixChannels(input.data(),
+                                    static_cast<size_t>(sfinfo.channels),
+                                    chunk->samples.data(),
+                                    2,
+                                    downmix.data(),
+                                    static_cast<size_t>(read));
+                    }
+                }
+                if (read <= 0) {
+                    if (looping && position > 0 && sf_seek(sndfile, 0, SEEK_SET) == 0) {
+                        position = 0;
+                    } else {
+                        atEnd = true;
+                    }
+                    continue;
+                }
+
+                chunk->generation = current;
+                chunk->start = position;
+                chunk->frames = static_cast<size_t>(read);
+                ring.commitWrite();
+                position += static_cast<uint64_t>(read);
+            }
+        }
+    };
+
+    AudioStream::AudioStream(const std::string &path, AudioContext &context) {
+        SF_INFO sfinfo{};
+        SNDFILE *sndfile = sf_open(path.c_str(), SFM_READ, &sfinfo);
+        if (!sndfile) {
+            auto err = sf_strerror(sndfile);
+            throw std::runtime_error("Failed to open audio file at " + path + "\nError: " + std::string(err));
+        }
+        if (sfinfo.channels < 1) {
+            sf_close(sndfile);
+            throw std::runtime_error("Unsupported channel count: " + std::to_string(sfinfo.channels));
+        }
+
+        std::vector<float> downmix;
+        if (sfinfo.channels > 2)
+            downmix = getStereoDownmix(sndfile, sfinfo.channels);
+
+        channels = static_cast<size_t>(std::min(sfinfo.channels, 2));
+        frequency = static_cast<unsigned int>(sfinfo.samplerate);
+        frames = static_cast<uint64_t>(std::max<sf_count_t>(sfinfo.frames, 0));
+        if (context.isFormatSupported(channels == 1 ? MONO_FLOAT32 : STEREO_FLOAT32)) {
+            format = channels == 1 ? MONO_FLOAT32 : STEREO_FLOAT32;
+        } else {
+            format = channels == 1 ? MONO16 : STEREO16;
+            conversion.resize(CHUNK_FRAMES * channels);
+        }
+
+        source = context.createSource();
+        for (size_t i = 0; i < QUEUED_BUFFERS; i++) {
+            buffers.emplace_back(context.createBuffer());
+            freeBuffers.emplace_back(buffers.back().get());
+        }
+
+        decoder = std::make_unique<Decoder>(sndfile, sfinfo, std::move(downmix));
+    }
+
+    AudioStream::~AudioStream() {
+        source->stop();
+        source->clearBuffer();
+    }
+
+    void AudioStream::play() {
+        playing = true;
+        update();
+    }
+
+    void AudioStream::pause() {
+        playing = false;
+        source->pause();
+    }
+
+    void AudioStream::stop() {
+        playing = false;
+        seek(0);
+    }
+
+    void AudioStream::seek(double seconds) {
+        auto frame = static_cast<uint64_t>(std::max(seconds, 0.0) * frequency);
+        if (frames > 0)
+            frame = std::min(frame, frames);
+
+        // A stopped source marks all of its buffers as processed.
+        source->stop();
+        unqueueProcessed();
+        queuedFrames.clear();
+        position = frame;
+
+        decoder->seekFrame = frame;
+        decoder->generation.fetch_add(1, std::memory_order_release);
+        decoder->wake();
+
+        update();
+    }
+
+    double AudioStream::getPosition() {
+        if (queuedFrames.empty())
+            return static_cast<double>(position) / frequency;
+        return static_cast<double>(queuedFrames.front()) / frequency + source->getOffset();
+    }
+
+    double AudioStream::getDuration() const {
+        return static_cast<double>(frames) / frequency;
+    }
+
+    void AudioStream::setLooping(bool looping) {
+        decoder->looping = looping;
+    }
+
+    void AudioStream::setGain(float gain) {
+        source->setGain(gain);
+    }
+
+    void AudioStream::update() {
+        if (!playing)
+            return;
+
+        unqueueProcessed();
+
+        auto generation = decoder->generation.load(std::memory_order_relaxed);
+        bool consumed = false;
+        while (!freeBuffers.empty()) {
+            auto *chunk = decoder->ring.beginRead();
+            if (chunk == nullptr)
+                break;
+            consumed = true;
+            if (chunk->generation != generation) {
+                // Decoded before the last seek.
+                decoder->ring.commitRead();
+                continue;
+            }
+
+            auto *buffer = freeBuffers.back();
+            auto samples = chunk->frames * channels;
+            if (conversion.empty()) {
+                buffer->upload(chunk->samples.data(), samples * sizeof(float), format, frequency);
+            } else {
+                convertFloatToInt16(chunk->samples.data(), conversion.data(), samples);
+                buffer->upload(conversion.data(), samples * sizeof(int16_t), format, frequency);
+            }
+            source->queueBuffers({*buffer});
+            queuedFrames.emplace_back(chunk->start);
+            position = chunk->start + chunk->frames;
+            freeBuffers.pop_back();
+            decoder->ring.commitRead();
+        }
+
+        if (consumed)
+            decoder->wake();
+
+        // The source stops by itself when it runs out of queued buffers.
+        if (!queuedFrames.empty() && source->getState() != AudioSource::PLAYING)
+            source->play();
+    }
+
+    void AudioStream::unqueueProcessed() {
+        for (auto &buffer: source->unqueueBuffers()) {
+            for (auto &owned: buffers) {
+                if (owned.get() == &buffer.get()) {
+                    freeBuffers.emplace_back(owned.get());
+                    break;
+                }
+            }
+            if (!queuedFrames.empty())
+                queuedFrames.pop_front();
+        }
+    }
+}
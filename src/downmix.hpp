@@ -0,0 +1,140 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef METRONOME_DOWNMIX_HPP
+#define METRONOME_DOWNMIX_HPP
+
+#include <vector>
+
+#include <sndfile.h>
+
+namespace engine {
+    /**
+     * @return The speaker positions of the channels in the WAVE default order for files without a channel map.
+     */
+    inline std::vector<int> getDefaultChannelMap(int channels) {
+        switch (channels) {
+            case 3:
+                return {SF_CHANNEL_MAP_LEFT, SF_CHANNEL_MAP_RIGHT, SF_CHANNEL_MAP_CENTER};
+            case 4:
+                return {SF_CHANNEL_MAP_FRONT_LEFT, SF_CHANNEL_MAP_FRONT_RIGHT,
+                        SF_CHANNEL_MAP_REAR_LEFT, SF_CHANNEL_MAP_REAR_RIGHT};
+            case 5:
+                return {SF_CHANNEL_MAP_FRONT_LEFT, SF_CHANNEL_MAP_FRONT_RIGHT, SF_CHANNEL_MAP_FRONT_CENTER,
+                        SF_CHANNEL_MAP_REAR_LEFT, SF_CHANNEL_MAP_REAR_RIGHT};
+            case 6:
+                return {SF_CHANNEL_MAP_FRONT_LEFT, SF_CHANNEL_MAP_FRONT_RIGHT, SF_CHANNEL_MAP_FRONT_CENTER,
+                        SF_CHANNEL_MAP_LFE, SF_CHANNEL_MAP_REAR_LEFT, SF_CHANNEL_MAP_REAR_RIGHT};
+            case 7:
+                return {SF_CHANNEL_MAP_FRONT_LEFT, SF_CHANNEL_MAP_FRONT_RIGHT, SF_CHANNEL_MAP_FRONT_CENTER,
+                        SF_CHANNEL_MAP_LFE, SF_CHANNEL_MAP_REAR_CENTER,
+                        SF_CHANNEL_MAP_SIDE_LEFT, SF_CHANNEL_MAP_SIDE_RIGHT};
+            case 8:
+                return {SF_CHANNEL_MAP_FRONT_LEFT, SF_CHANNEL_MAP_FRONT_RIGHT, SF_CHANNEL_MAP_FRONT_CENTER,
+                        SF_CHANNEL_MAP_LFE, SF_CHANNEL_MAP_REAR_LEFT, SF_CHANNEL_MAP_REAR_RIGHT,
+                        SF_CHANNEL_MAP_SIDE_LEFT, SF_CHANNEL_MAP_SIDE_RIGHT};
+            default:
+                return std::vector<int>(static_cast<size_t>(channels), SF_CHANNEL_MAP_INVALID);
+        }
+    }
+
+    /**
+     * Create the matrix which mixes the channels of the file down to stereo, for use with mixChannels.
+     *
+     * The speaker positions are read from the channel map of the file and follow the WAVE default order if it has none.
+     * Center and surround channels are attenuated by 3 dB as in ITU-R BS.775 and the LFE channel is dropped.
+     * Channels at unknown positions are distributed alternately to the left and right output.
+     */
+    inline std::vector<float> getStereoDownmix(SNDFILE *sndfile, int channels) {
+        const float attenuated = 0.70710678f;
+
+        std::vector<int> map(static_cast<size_t>(channels));
+        if (!sf_command(sndfile, SFC_GET_CHANNEL_MAP_INFO, map.data(), static_cast<int>(map.size() * sizeof(int))))
+            map = getDefaultChannelMap(channels);
+
+        std::vector<float> ret(map.size() * 2, 0.0f);
+        float *left = ret.data();
+        float *right = ret.data() + map.size();
+        size_t unknownLeft = 0;
+        size_t unknownRight = 0;
+        for (size_t i = 0; i < map.size(); i++) {
+            switch (map[i]) {
+                case SF_CHANNEL_MAP_LEFT:
+                case SF_CHANNEL_MAP_FRONT_LEFT:
+                case SF_CHANNEL_MAP_FRONT_LEFT_OF_CENTER:
+                    left[i] = 1;
+                    break;
+                case SF_CHANNEL_MAP_RIGHT:
+                case SF_CHANNEL_MAP_FRONT_RIGHT:
+                case SF_CHANNEL_MAP_FRONT_RIGHT_OF_CENTER:
+                    right[i] = 1;
+                    break;
+                case SF_CHANNEL_MAP_REAR_LEFT:
+                case SF_CHANNEL_MAP_SIDE_LEFT:
+                case SF_CHANNEL_MAP_TOP_FRONT_LEFT:
+                case SF_CHANNEL_MAP_TOP_REAR_LEFT:
+                    left[i] = attenuated;
+                    break;
+                case SF_CHANNEL_MAP_REAR_RIGHT:
+                case SF_CHANNEL_MAP_SIDE_RIGHT:
+                case SF_CHANNEL_MAP_TOP_FRONT_RIGHT:
+                case SF_CHANNEL_MAP_TOP_REAR_RIGHT:
+                    right[i] = attenuated;
+                    break;
+                case SF_CHANNEL_MAP_MONO:
+                case SF_CHANNEL_MAP_CENTER:
+                case SF_CHANNEL_MAP_FRONT_CENTER:
+                case SF_CHANNEL_MAP_REAR_CENTER:
+                case SF_CHANNEL_MAP_TOP_CENTER:
+                case SF_CHANNEL_MAP_TOP_FRONT_CENTER:
+                case SF_CHANNEL_MAP_TOP_REAR_CENTER:
+                case SF_CHANNEL_MAP_AMBISONIC_B_W:
+                    left[i] = attenuated;
+                    right[i] = attenuated;
+                    break;
+                case SF_CHANNEL_MAP_LFE:
+                case SF_CHANNEL_MAP_AMBISONIC_B_X:
+                case SF_CHANNEL_MAP_AMBISONIC_B_Y:
+                case SF_CHANNEL_MAP_AMBISONIC_B_Z:
+                    break;
+                default:
+                    if (unknownLeft <= unknownRight) {
+                        left[i] = -1;
+                        unknownLeft++;
+                    } else {
+                        right[i] = -1;
+                        unknownRight++;
+                    }
+                    break;
+            }
+        }
+
+        // Unknown channels share the output side evenly so that the mix does not grow with the channel count.
+        for (size_t i = 0; i < map.size(); i++) {
+            if (left[i] < 0)
+                left[i] = 1.0f / static_cast<float>(unknownLeft);
+            if (right[i] < 0)
+                right[i] = 1.0f / static_cast<float>(unknownRight);
+        }
+
+        return ret;
+    }
+}
+
+#endif //METRONOME_DOWNMIX_HPP
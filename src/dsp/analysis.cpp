@@ -0,0 +1,128 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "dsp/analysis.hpp"
+#include "dsp/simd.hpp"
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+namespace engine {
+    SignalLevel measureLevel(const float *samples, size_t count) {
+        SignalLevel ret;
+        if (count == 0)
+            return ret;
+
+        size_t i = 0;
+        float minimum = std::numeric_limits<float>::infinity();
+        float maximum = -std::numeric_limits<float>::infinity();
+#if defined(METRONOME_AVX2)
+        __m256 low = _mm256_set1_ps(minimum);
+        __m256 high = _mm256_set1_ps(maximum);
+        __m256 energy = _mm256_setzero_ps();
+        for (; i + 8 <= count; i += 8) {
+            __m256 v = _mm256_loadu_ps(samples + i);
+            low = _mm256_min_ps(low, v);
+            high = _mm256_max_ps(high, v);
+            energy = _mm256_add_ps(energy, _mm256_mul_ps(v, v));
+        }
+        __m128 l = _mm_min_ps(_mm256_castps256_ps128(low), _mm256_extractf128_ps(low, 1));
+        l = _mm_min_ps(l, _mm_movehl_ps(l, l));
+        l = _mm_min_ss(l, _mm_shuffle_ps(l, l, 1));
+        minimum = _mm_cvtss_f32(l);
+        __m128 h = _mm_max_ps(_mm256_castps256_ps128(high), _mm256_extractf128_ps(high, 1));
+        h = _mm_max_ps(h, _mm_movehl_ps(h, h));
+        h = _mm_max_ss(h, _mm_shuffle_ps(h, h, 1));
+        maximum = _mm_cvtss_f32(h);
+        alignas(32) float lanes[8];
+        _mm256_store_ps(lanes, energy);
+        for (auto lane: lanes)
+            ret.energy += lane;
+#elif defined(METRONOME_SSE2)
+        __m128 low = _mm_set1_ps(minimum);
+        __m128 high = _mm_set1_ps(maximum);
+        __m128 energy = _mm_setzero_ps();
+        for (; i + 4 <= count; i += 4) {
+            __m128 v = _mm_loadu_ps(samples + i);
+            low = _mm_min_ps(low, v);
+            high = _mm_max_ps(high, v);
+            energy = _mm_add_ps(energy, _mm_mul_ps(v, v));
+        }
+        low = _mm_min_ps(low, _mm_movehl_ps(low, low));
+        low = _mm_min_ss(low, _mm_shuffle_ps(low, low, 1));
+        minimum = _mm_cvtss_f32(low);
+        high = _mm_max_ps(high, _mm_movehl_ps(high, high));
+        high = _mm_max_ss(high, _mm_shuffle_ps(high, high, 1));
+        maximum = _mm_cvtss_f32(high);
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, energy);
+        for (auto lane: lanes)
+            ret.energy += lane;
+#elif defined(METRONOME_NEON)
+        float32x4_t low = vdupq_n_f32(minimum);
+        float32x4_t high = vdupq_n_f32(maximum);
+        float32x4_t energy = vdupq_n_f32(0);
+        for (; i + 4 <= count; i += 4) {
+            float32x4_t v = vld1q_f32(samples + i);
+            low = vminq_f32(low, v);
+            high = vmaxq_f32(high, v);
+            energy = vmlaq_f32(energy, v, v);
+        }
+        minimum = vminvq_f32(low);
+        maximum = vmaxvq_f32(high);
+        ret.energy = vaddvq_f32(energy);
+#endif
+        for (; i < count; i++) {
+            minimum = std::min(minimum, samples[i]);
+            maximum = std::max(maximum, samples[i]);
+            ret.energy += static_cast<double>(samples[i]) * samples[i];
+        }
+        ret.minimum = minimum;
+        ret.maximum = maximum;
+        ret.peak = std::max(-minimum, maximum);
+        return ret;
+    }
+
+    size_t findFirstAbove(const float *samples, size_t count, float threshold) {
+        size_t i = 0;
+#if defined(METRONOME_SSE2)
+        const __m128 mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+        const __m128 limit = _mm_set1_ps(threshold);
+        for (; i + 8 <= count; i += 8) {
+            int a = _mm_movemask_ps(_mm_cmpge_ps(_mm_and_ps(_mm_loadu_ps(samples + i), mask), limit));
+            int b = _mm_movemask_ps(_mm_cmpge_ps(_mm_and_ps(_mm_loadu_ps(samples + i + 4), mask), limit));
+            int bits = a | (b << 4);
+            if (bits != 0)
+                return i + __builtin_ctz(static_cast<unsigned int>(bits));
+        }
+#elif defined(METRONOME_NEON)
+        const float32x4_t limit = vdupq_n_f32(threshold);
+        for (; i + 4 <= count; i += 4) {
+            if (vmaxvq_u32(vcgeq_f32(vabsq_f32(vld1q_f32(samples + i)), limit)) != 0)
+                break;
+        }
+#endif
+        for (; i < count; i++) {
+            if (std::abs(samples[i]) >= threshold)
+                return i;
+        }
+        return count;
+    }
+}
@@ -0,0 +1,247 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "dsp/convert.hpp"
+#include "dsp/simd.hpp"
+
+#include <vector>
+#include <cmath>
+
+namespace engine {
+    static const float INT16_SCALE = 32768.0f;
+
+    static int16_t toInt16(float v) {
+        float s = std::nearbyint(v * INT16_SCALE);
+        if (s >= 32767.0f)
+            return 32767;
+        if (s <= -32768.0f)
+            return -32768;
+        return static_cast<int16_t>(s);
+    }
+
+    void convertInt16ToFloat(const int16_t *in, float *out, size_t count) {
+        size_t i = 0;
+#if defined(METRONOME_AVX2)
+        const __m256 scale = _mm256_set1_ps(1.0f / INT16_SCALE);
+        for (; i + 16 <= count; i += 16) {
+            __m256i a = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)));
+            __m256i b = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + 8)));
+            _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(a), scale));
+            _mm256_storeu_ps(out + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(b), scale));
+        }
+#elif defined(METRONOME_SSE2)
+        const __m128 scale = _mm_set1_ps(1.0f / INT16_SCALE);
+        for (; i + 8 <= count; i += 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+            // Sign extend by moving each sample into the upper half of a 32 bit lane and shifting it back down.
+            __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+            __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+            _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+            _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+        }
+#elif defined(METRONOME_NEON)
+        const float32x4_t scale = vdupq_n_f32(1.0f / INT16_SCALE);
+        for (; i + 8 <= count; i += 8) {
+            int16x8_t v = vld1q_s16(in + i);
+            vst1q_f32(out + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), scale));
+            vst1q_f32(out + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), scale));
+        }
+#endif
+        for (; i < count; i++) {
+            out[i] = static_cast<float>(in[i]) / INT16_SCALE;
+        }
+    }
+
+    void convertFloatToInt16(const float *in, int16_t *out, size_t count) {
+        // Every iteration loads its input before storing the (smaller) output, which makes in place conversion safe.
+        size_t i = 0;
+#if defined(METRONOME_AVX2)
+        // Clamp before converting, out of range values would otherwise turn into INT32_MIN.
+        const __m256 scale = _mm256_set1_ps(INT16_SCALE);
+        const __m256 minimum = _mm256_set1_ps(-32768.0f);
+        const __m256 maximum = _mm256_set1_ps(32767.0f);
+        for (; i + 16 <= count; i += 16) {
+            __m256 fa = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i), scale), minimum), maximum);
+            __m256 fb = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i + 8), scale), minimum), maximum);
+            __m256i a = _mm256_cvtps_epi32(fa);
+            __m256i b = _mm256_cvtps_epi32(fb);
+            // packs works per 128 bit lane, restore the sample order afterwards.
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), packed);
+        }
+#elif defined(METRONOME_SSE2)
+        // Clamp before converting, out of range values would otherwise turn into INT32_MIN.
+        const __m128 scale = _mm_set1_ps(INT16_SCALE);
+        const __m128 minimum = _mm_set1_ps(-32768.0f);
+        const __m128 maximum = _mm_set1_ps(32767.0f);
+        for (; i + 8 <= count; i += 8) {
+            __m128 fa = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i), scale), minimum), maximum);
+            __m128 fb = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 4), scale), minimum), maximum);
+            __m128i a = _mm_cvtps_epi32(fa);
+            __m128i b = _mm_cvtps_epi32(fb);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packs_epi32(a, b));
+        }
+#elif defined(METRONOME_NEON)
+        const float32x4_t scale = vdupq_n_f32(INT16_SCALE);
+        for (; i + 8 <= count; i += 8) {
+            int32x4_t a = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(in + i), scale));
+            int32x4_t b = vcvtnq_s32_f32(vmulq_f32(vld1q_f32(in + i + 4), scale));
+            vst1q_s16(out + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+        }
+#endif
+        for (; i < count; i++) {
+            out[i] = toInt16(in[i]);
+        }
+    }
+
+    void applyGain(float *samples, size_t count, float gain) {
+        size_t i = 0;
+#if defined(METRONOME_AVX2)
+        const __m256 g = _mm256_set1_ps(gain);
+        for (; i + 8 <= count; i += 8) {
+            _mm256_storeu_ps(samples + i, _mm256_mul_ps(_mm256_loadu_ps(samples + i), g));
+        }
+#elif defined(METRONOME_SSE2)
+        const __m128 g = _mm_set1_ps(gain);
+        for (; i + 4 <= count; i += 4) {
+            _mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), g));
+        }
+#elif defined(METRONOME_NEON)
+        const float32x4_t g = vdupq_n_f32(gain);
+        for (; i + 4 <= count; i += 4) {
+            vst1q_f32(samples + i, vmulq_f32(vld1q_f32(samples + i), g));
+        }
+#endif
+        for (; i < count; i++) {
+            samples[i] *= gain;
+        }
+    }
+
+    void mixChannels(const float *in,
+                     size_t inChannels,
+                     float *out,
+                     size_t outChannels,
+                     const float *matrix,
+                     size_t frames) {
+        size_t i = 0;
+#if defined(METRONOME_SSE2) || defined(METRONOME_NEON)
+        if (outChannels <= 4) {
+            // Every input sample is broadcast and multiplied with its zero padded matrix column,
+            // accumulating all output channels of a frame in one register.
+            std::vector<float> columns(inChannels * 4, 0.0f);
+            for (size_t c = 0; c < inChannels; c++) {
+                for (size_t o = 0; o < outChannels; o++)
+                    columns[c * 4 + o] = matrix[o * inChannels + c];
+            }
+            // The full register store spills zeros into the following frame which overwrites them,
+            // the frames without room for the spill are left to the scalar loop.
+            for (; i * outChannels + 4 <= frames * outChannels; i++) {
+                const float *frame = in + i * inChannels;
+#if defined(METRONOME_SSE2)
+                __m128 sum = _mm_setzero_ps();
+                for (size_t c = 0; c < inChannels; c++)
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(frame[c]), _mm_loadu_ps(columns.data() + c * 4)));
+                _mm_storeu_ps(out + i * outChannels, sum);
+#else
+                float32x4_t sum = vdupq_n_f32(0.0f);
+                for (size_t c = 0; c < inChannels; c++)
+                    sum = vmlaq_f32(sum, vdupq_n_f32(frame[c]), vld1q_f32(columns.data() + c * 4));
+                vst1q_f32(out + i * outChannels, sum);
+#endif
+            }
+        }
+#endif
+        for (; i < frames; i++) {
+            const float *frame = in + i * inChannels;
+            for (size_t o = 0; o < outChannels; o++) {
+                float sum = 0;
+                for (size_t c = 0; c < inChannels; c++)
+                    sum += frame[c] * matrix[o * inChannels + c];
+                out[i * outChannels + o] = sum;
+            }
+        }
+    }
+
+    void deinterleave(const float *in, float *const *out, size_t channels, size_t frames) {
+        if (channels == 1) {
+            for (size_t i = 0; i < frames; i++)
+                out[0][i] = in[i];
+            return;
+        }
+
+        size_t i = 0;
+        if (channels == 2) {
+            float *left = out[0];
+            float *right = out[1];
+#if defined(METRONOME_SSE2)
+            for (; i + 4 <= frames; i += 4) {
+                __m128 a = _mm_loadu_ps(in + i * 2);
+                __m128 b = _mm_loadu_ps(in + i * 2 + 4);
+                _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+                _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+            }
+#elif defined(METRONOME_NEON)
+            for (; i + 4 <= frames; i += 4) {
+                float32x4x2_t v = vld2q_f32(in + i * 2);
+                vst1q_f32(left + i, v.val[0]);
+                vst1q_f32(right + i, v.val[1]);
+            }
+#endif
+        }
+
+        for (; i < frames; i++) {
+            for (size_t c = 0; c < channels; c++)
+                out[c][i] = in[i * channels + c];
+        }
+    }
+
+    void interleave(const float *const *in, float *out, size_t channels, size_t frames) {
+        if (channels == 1) {
+            for (size_t i = 0; i < frames; i++)
+                out[i] = in[0][i];
+            return;
+        }
+
+        size_t i = 0;
+        if (channels == 2) {
+            const float *left = in[0];
+            const float *right = in[1];
+#if defined(METRONOME_SSE2)
+            for (; i + 4 <= frames; i += 4) {
+                __m128 l = _mm_loadu_ps(left + i);
+                __m128 r = _mm_loadu_ps(right + i);
+                _mm_storeu_ps(out + i * 2, _mm_unpacklo_ps(l, r));
+                _mm_storeu_ps(out + i * 2 + 4, _mm_unpackhi_ps(l, r));
+            }
+#elif defined(METRONOME_NEON)
+            for (; i + 4 <= frames; i += 4) {
+                float32x4x2_t v;
+                v.val[0] = vld1q_f32(left + i);
+                v.val[1] = vld1q_f32(right + i);
+                vst2q_f32(out + i * 2, v);
+            }
+#endif
+        }
+
+        for (; i < frames; i++) {
+            for (size_t c = 0; c < channels; c++)
+                out[i * channels + c] = in[c][i];
+        }
+    }
+}
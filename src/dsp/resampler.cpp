@@ -0,0 +1,137 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "dsp/resampler.hpp"
+#include "dsp/simd.hpp"
+
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <algorithm>
+
+namespace engine {
+    static const double KAISER_BETA = 8.6;
+
+    static double besselI0(double x) {
+        double sum = 1;
+        double term = 1;
+        for (int k = 1; k < 32; k++) {
+            term *= (x / (2 * k)) * (x / (2 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    static float dot(const float *a, const float *b, size_t count) {
+        size_t i = 0;
+        float ret;
+#if defined(METRONOME_AVX2)
+        __m256 acc = _mm256_setzero_ps();
+        for (; i + 8 <= count; i += 8) {
+#if defined(__FMA__)
+            acc = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc);
+#else
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+#endif
+        }
+        __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+        ret = _mm_cvtss_f32(sum);
+#elif defined(METRONOME_SSE2)
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        for (; i + 8 <= count; i += 8) {
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+        }
+        __m128 sum = _mm_add_ps(acc0, acc1);
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+        ret = _mm_cvtss_f32(sum);
+#elif defined(METRONOME_NEON)
+        float32x4_t acc0 = vdupq_n_f32(0);
+        float32x4_t acc1 = vdupq_n_f32(0);
+        for (; i + 8 <= count; i += 8) {
+            acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+            acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+        }
+        ret = vaddvq_f32(vaddq_f32(acc0, acc1));
+#else
+        ret = 0;
+#endif
+        for (; i < count; i++) {
+            ret += a[i] * b[i];
+        }
+        return ret;
+    }
+
+    Resampler::Resampler(unsigned int inputRate, unsigned int outputRate, unsigned int zeroCrossings) {
+        if (inputRate == 0 || outputRate == 0)
+            throw std::runtime_error("Invalid resampling rate");
+
+        size_t divisor = std::gcd(inputRate, outputRate);
+        interpolation = outputRate / divisor;
+        decimation = inputRate / divisor;
+        phases = std::min(interpolation, MAXIMUM_PHASES);
+
+        // When downsampling the cutoff moves below the output nyquist frequency and the filter widens accordingly.
+        double cutoff = std::min(1.0, static_cast<double>(outputRate) / inputRate) * 0.97;
+        halfTaps = static_cast<size_t>(std::ceil(zeroCrossings / cutoff));
+        taps = (halfTaps * 2 + 7) & ~static_cast<size_t>(7);
+
+        double norm = besselI0(KAISER_BETA);
+        filters.resize((phases + 1) * taps);
+        for (size_t phase = 0; phase <= phases; phase++) {
+            double fraction = static_cast<double>(phase) / phases;
+            float *filter = filters.data() + phase * taps;
+            for (size_t k = 0; k < taps; k++) {
+                // Distance between the output position and the input sample in input samples.
+                double x = static_cast<double>(k) - static_cast<double>(halfTaps) + 1 - fraction;
+                double w = x / static_cast<double>(halfTaps);
+                if (k >= halfTaps * 2 || std::abs(w) >= 1) {
+                    filter[k] = 0;
+                    continue;
+                }
+                double sinc = x == 0 ? 1 : std::sin(M_PI * cutoff * x) / (M_PI * cutoff * x);
+                double window = besselI0(KAISER_BETA * std::sqrt(1 - w * w)) / norm;
+                filter[k] = static_cast<float>(cutoff * sinc * window);
+            }
+        }
+    }
+
+    size_t Resampler::getOutputFrames(size_t inputFrames) const {
+        return (inputFrames * interpolation + decimation - 1) / decimation;
+    }
+
+    void Resampler::process(const float *in, size_t inputFrames, float *out, size_t outStride) const {
+        size_t outputFrames = getOutputFrames(inputFrames);
+        for (size_t n = 0; n < outputFrames; n++) {
+            // Output frame n lies at input position n * decimation / interpolation.
+            size_t position = n * decimation;
+            size_t index = position / interpolation;
+            size_t remainder = position % interpolation;
+            size_t phase = phases == interpolation
+                           ? remainder
+                           : (remainder * phases + interpolation / 2) / interpolation;
+            const float *filter = filters.data() + phase * taps;
+            out[n * outStride] = dot(filter, in + static_cast<ptrdiff_t>(index) - static_cast<ptrdiff_t>(halfTaps) + 1, taps);
+        }
+    }
+}
@@ -0,0 +1,159 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "filewatcher.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace engine {
+    FileWatcher::FileWatcher(Callback callback, std::chrono::milliseconds debounce)
+            : callback(std::move(callback)), debounce(debounce) {
+        notifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (notifyDescriptor < 0) {
+            throw std::runtime_error(std::string("Failed to create inotify instance\nError: ") + std::strerror(errno));
+        }
+        wakeDescriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wakeDescriptor < 0) {
+            close(notifyDescriptor);
+            throw std::runtime_error(std::string("Failed to create eventfd\nError: ") + std::strerror(errno));
+        }
+        thread = std::thread([this]() { run(); });
+    }
+
+    FileWatcher::~FileWatcher() {
+        runFlag = false;
+        uint64_t value = 1;
+        if (write(wakeDescriptor, &value, sizeof(value)) < 0) {
+            // The counter can only overflow if the thread already stopped reading it.
+        }
+        thread.join();
+        close(wakeDescriptor);
+        close(notifyDescriptor);
+    }
+
+    void FileWatcher::watch(const std::vector<std::string> &paths) {
+        std::map<std::string, std::multimap<std::string, std::string>> files;
+        for (auto &path: paths) {
+            auto separator = path.find_last_of('/');
+            if (separator == std::string::npos) {
+                files["."].emplace(path, path);
+            } else {
+                files[separator == 0 ? "/" : path.substr(0, separator)].emplace(path.substr(separator + 1), path);
+            }
+        }
+
+        std::lock_guard<std::mutex> guard(mutex);
+
+        // Watching the same directory through another path returns the same descriptor,
+        // so the files are collected by descriptor and aliases of a directory share one entry.
+        std::map<int, std::multimap<std::string, std::string>> watched;
+        for (auto &pair: files) {
+            int descriptor = inotify_add_watch(notifyDescriptor,
+                                               pair.first.c_str(),
+                                               IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR);
+            if (descriptor < 0)
+                continue;
+            watched[descriptor].insert(pair.second.begin(), pair.second.end());
+        }
+
+        for (auto &pair: directories) {
+            if (watched.find(pair.first) == watched.end())
+                inotify_rm_watch(notifyDescriptor, pair.first);
+        }
+        directories = std::move(watched);
+    }
+
+    void FileWatcher::run() {
+        typedef std::chrono::steady_clock Clock;
+
+        std::map<std::string, Clock::time_point> changes; // The modified paths and when to report them
+        std::vector<std::string> ready;
+
+        alignas(struct inotify_event) char buffer[4096];
+
+        while (runFlag) {
+            int timeout = -1;
+            if (!changes.empty()) {
+                auto deadline = std::min_element(changes.begin(), changes.end(),
+                                                 [](const std::pair<const std::string, Clock::time_point> &a,
+                                                    const std::pair<const std::string, Clock::time_point> &b) {
+                                                     return a.second < b.second;
+                                                 })->second;
+                auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+                timeout = static_cast<int>(std::max<std::chrono::milliseconds::rep>(remaining.count() + 1, 0));
+            }
+
+            pollfd fds[2] = {{notifyDescriptor, POLLIN, 0},
+                             {wakeDescriptor,   POLLIN, 0}};
+            if (poll(fds, 2, timeout) < 0) {
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+
+            if (fds[1].revents & POLLIN) {
+                uint64_t value;
+                if (read(wakeDescriptor, &value, sizeof(value)) < 0) {
+                    // Another wake up consumed the counter already.
+                }
+            }
+
+            if (fds[0].revents & POLLIN) {
+                auto now = Clock::now();
+                ssize_t length;
+                while ((length = read(notifyDescriptor, buffer, sizeof(buffer))) > 0) {
+                    std::lock_guard<std::mutex> guard(mutex);
+                    for (char *ptr = buffer; ptr < buffer + length;) {
+                        auto event = reinterpret_cast<const struct inotify_event *>(ptr);
+                        ptr += sizeof(struct inotify_event) + event->len;
+                        if (event->len == 0)
+                            continue;
+                        auto directory = directories.find(event->wd);
+                        if (directory == directories.end())
+                            continue;
+                        auto files = directory->second.equal_range(event->name);
+                        for (auto file = files.first; file != files.second; file++)
+                            changes[file->second] = now + debounce;
+                    }
+                }
+            }
+
+            auto now = Clock::now();
+            for (auto it = changes.begin(); it != changes.end();) {
+                if (it->second <= now) {
+                    ready.emplace_back(it->first);
+                    it = changes.erase(it);
+                } else {
+                    it++;
+                }
+            }
+            for (auto &path: ready)
+                callback(path);
+            ready.clear();
+        }
+    }
+}
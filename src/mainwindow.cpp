@@ -19,14 +19,40 @@
 
 #include "mainwindow.hpp"
 
-#include "defaultsample.hpp"
+#include "assets.hpp"
 
 MainWindow::MainWindow()
         : metronome() {
     const int defaultBPM = 40;
 
+    // User samples are normalized so that switching samples does not change the click volume.
+    engine::AudioLoadOptions loadOptions;
+    loadOptions.resample = true;
+    loadOptions.normalize = true;
+    loadOptions.cache = true;
+
     metronome.setBPM(defaultBPM);
-    metronome.setSampleData(std::string((char *) default_wav, default_wav_len));
+    metronome.setLoadOptions(loadOptions);
+    // Long samples start clicking after their first half second is decoded.
+    metronome.setProgressiveLoading(0.5f);
+    metronome.setKit(defaultKit());
+
+    // Sample files modified while the metronome runs are reloaded in the background.
+    metronome.setReloadListener([this](const std::string &path, std::exception_ptr error) {
+        QMetaObject::invokeMethod(this, [this, path, error]() {
+            if (!error) {
+                waveformWidget->setWaveform(metronome.getWaveform());
+                return;
+            }
+            try {
+                std::rethrow_exception(error);
+            } catch (std::exception &e) {
+                QMessageBox::warning(this,
+                                     QString("Failed to reload Audio Sample"),
+                                     QString::fromStdString(path) + "\n" + QString(e.what()));
+            }
+        }, Qt::QueuedConnection);
+    });
 
     centralWidget = new QWidget();
     centralWidget->setLayout(new QVBoxLayout());
@@ -46,42 +72,208 @@ MainWindow::MainWindow()
     sampleLabel = new QLabel(this);
     sampleLabel->setText("Default Sample");
 
+    waveformWidget = new WaveformWidget(this);
+    waveformWidget->setWaveform(metronome.getWaveform());
+
     selectSampleButton = new QPushButton(this);
     selectSampleButton->setText("Select Sample");
 
     sampleWidget->layout()->addWidget(sampleLabel);
     sampleWidget->layout()->addWidget(selectSampleButton);
 
+    auto backingTrackWidget = new QWidget(this);
+    backingTrackWidget->setLayout(new QHBoxLayout());
+
+    backingTrackLabel = new QLabel(this);
+    backingTrackLabel->setText("No Backing Track");
+
+    selectBackingTrackButton = new QPushButton(this);
+    selectBackingTrackButton->setText("Select Backing Track");
+
+    backingTrackWidget->layout()->addWidget(backingTrackLabel);
+    backingTrackWidget->layout()->addWidget(selectBackingTrackButton);
+
     connect(controlButton, SIGNAL(pressed()), this, SLOT(toggle()));
     connect(bpmSpinBox, SIGNAL(valueChanged(int)), this, SLOT(setBPM(int)));
     connect(selectSampleButton, SIGNAL(pressed()), this, SLOT(selectSampleButtonPressed()));
+    connect(selectBackingTrackButton, SIGNAL(pressed()), this, SLOT(selectBackingTrackButtonPressed()));
+
+    auto libraryWidget = new QWidget(this);
+    libraryWidget->setLayout(new QVBoxLayout());
+
+    auto libraryHeaderWidget = new QWidget(this);
+    libraryHeaderWidget->setLayout(new QHBoxLayout());
+
+    libraryLabel = new QLabel(this);
+
+    selectLibraryButton = new QPushButton(this);
+    selectLibraryButton->setText("Select Library");
+
+    librarySearchEdit = new QLineEdit(this);
+    librarySearchEdit->setPlaceholderText("Search Samples");
+
+    libraryList = new QListWidget(this);
+
+    libraryHeaderWidget->layout()->addWidget(libraryLabel);
+    libraryHeaderWidget->layout()->addWidget(selectLibraryButton);
+    libraryWidget->layout()->addWidget(libraryHeaderWidget);
+    libraryWidget->layout()->addWidget(librarySearchEdit);
+    libraryWidget->layout()->addWidget(libraryList);
+
+    connect(selectLibraryButton, SIGNAL(pressed()), this, SLOT(selectLibraryButtonPressed()));
+    connect(librarySearchEdit, SIGNAL(textChanged(const QString &)), this, SLOT(librarySearchChanged(const QString &)));
+    connect(libraryList, SIGNAL(itemActivated(QListWidgetItem *)), this, SLOT(libraryItemActivated(QListWidgetItem *)));
+
+    // The stored index is shown without touching the library, changes are picked up in the background.
+    library = std::make_shared<engine::SampleIndex>();
+    showLibrary();
+    if (!library->getRoot().empty())
+        updateLibrary(library->getRoot());
 
     centralWidget->layout()->addWidget(controlButton);
     centralWidget->layout()->addWidget(bpmSpinBox);
     centralWidget->layout()->addWidget(sampleWidget);
-    centralWidget->layout()->addItem(new QSpacerItem(0, 0, QSizePolicy::Expanding, QSizePolicy::Expanding));
+    centralWidget->layout()->addWidget(waveformWidget);
+    centralWidget->layout()->addWidget(backingTrackWidget);
+    centralWidget->layout()->addWidget(libraryWidget);
+}
+
+SampleKit MainWindow::defaultKit() {
+    auto asset = getDefaultSampleAsset();
+    return SampleKit::fromPcm(asset.data, asset.size);
 }
 
 void MainWindow::selectSampleButtonPressed() {
-    stop();
     auto path = QFileDialog::getOpenFileName(this, tr("Select Audio Sample"));
     if (!path.isNull()) {
-        bool success = false;
+        loadKit(SampleKit::fromPath(path.toStdString()), path);
+    } else {
+        if (QMessageBox::question(this, "Use Default Sample", "Do you want to use the default sample?")) {
+            loadKit(defaultKit(), "Default Sample");
+        }
+    }
+}
+
+void MainWindow::loadKit(const SampleKit &kit, const QString &name) {
+    // The metronome keeps playing the previous kit while the new one loads in the background.
+    sampleLabel->setText("Loading " + name);
+    metronome.loadKitAsync(kit, [this, name](std::exception_ptr error) {
+        QMetaObject::invokeMethod(this, [this, name, error]() {
+            if (!error) {
+                sampleLabel->setText(name);
+                waveformWidget->setWaveform(metronome.getWaveform());
+                return;
+            }
+            sampleLabel->setText("Failed to load " + name);
+            try {
+                std::rethrow_exception(error);
+            } catch (std::exception &e) {
+                QMessageBox::critical(this,
+                                      QString("Failed to open Audio Sample"),
+                                      QString(e.what()));
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MainWindow::selectBackingTrackButtonPressed() {
+    stop();
+    auto path = QFileDialog::getOpenFileName(this, tr("Select Backing Track"));
+    if (!path.isNull()) {
         try {
-            setSamplePath(path.toStdString());
-            success = true;
+            metronome.setBackingTrack(path.toStdString());
+            backingTrackLabel->setText(path);
         } catch (std::exception &e) {
             QMessageBox::critical(this,
-                                  QString("Failed to open Audio Sample"),
+                                  QString("Failed to open Backing Track"),
                                   QString(e.what()));
         }
-        if (success) {
-            sampleLabel->setText(path);
-        }
     } else {
-        if (QMessageBox::question(this, "Use Default Sample", "Do you want to use the default sample?")) {
-            sampleLabel->setText("Default Sample");
-            metronome.setSampleData(std::string((char *) default_wav, default_wav_len));
+        if (QMessageBox::question(this, "Remove Backing Track", "Do you want to remove the backing track?")
+            == QMessageBox::Yes) {
+            backingTrackLabel->setText("No Backing Track");
+            metronome.setBackingTrack("");
+        }
+    }
+}
+
+void MainWindow::selectLibraryButtonPressed() {
+    auto directory = QFileDialog::getExistingDirectory(this, tr("Select Sample Library"));
+    if (!directory.isNull())
+        updateLibrary(directory.toStdString());
+}
+
+void MainWindow::librarySearchChanged(const QString &) {
+    showLibrary();
+}
+
+void MainWindow::libraryItemActivated(QListWidgetItem *item) {
+    auto path = item->data(Qt::UserRole).toString();
+    loadKit(SampleKit::fromPath(path.toStdString()), path);
+}
+
+void MainWindow::updateLibrary(const std::string &root) {
+    if (libraryUpdating) {
+        pendingLibraryRoot = root;
+        libraryLabel->setText("Indexing " + QString::fromStdString(root) + " after the current update");
+        return;
+    }
+
+    libraryUpdating = true;
+    libraryLabel->setText("Indexing " + QString::fromStdString(root));
+
+    // The update works on a copy so that the list keeps browsing the current index meanwhile.
+    auto index = std::make_shared<engine::SampleIndex>(*library);
+    libraryUpdate = std::async(std::launch::async, [this, index, root]() {
+        std::exception_ptr error;
+        bool updated = false;
+        try {
+            index->update(root);
+            updated = true;
+            index->save();
+        } catch (...) {
+            error = std::current_exception();
         }
+        QMetaObject::invokeMethod(this, [this, index, error, updated]() {
+            // A failed scan keeps the previous index, a failed save still shows the scanned one.
+            if (updated)
+                library = index;
+            libraryUpdating = false;
+            showLibrary();
+            if (!pendingLibraryRoot.empty()) {
+                auto next = std::move(pendingLibraryRoot);
+                pendingLibraryRoot.clear();
+                updateLibrary(next);
+            }
+            if (!error)
+                return;
+            try {
+                std::rethrow_exception(error);
+            } catch (std::exception &e) {
+                QMessageBox::warning(this,
+                                     QString(updated ? "Failed to save Sample Library index"
+                                                     : "Failed to update Sample Library"),
+                                     QString(e.what()));
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MainWindow::showLibrary() {
+    auto &root = library->getRoot();
+    libraryLabel->setText(root.empty() ? QString("No Sample Library") : QString::fromStdString(root));
+
+    libraryList->clear();
+    for (auto *entry: library->search(librarySearchEdit->text().toStdString())) {
+        auto *item = new QListWidgetItem(QString::fromStdString(entry->path));
+        item->setData(Qt::UserRole, QString::fromStdString(root + "/" + entry->path));
+        item->setToolTip(QString("%1\n%2 channels, %3 Hz, %4 s\nOnset %5 ms, %6 dBFS")
+                                 .arg(QString::fromStdString(engine::SampleIndex::getFormatName(entry->format)))
+                                 .arg(entry->channels)
+                                 .arg(entry->frequency)
+                                 .arg(entry->duration, 0, 'f', 2)
+                                 .arg(entry->onset * 1000, 0, 'f', 1)
+                                 .arg(entry->loudness, 0, 'f', 1));
+        libraryList->addItem(item);
     }
 }
@@ -28,10 +28,15 @@
 #include <QMessageBox>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
+#include <QLineEdit>
+#include <QListWidget>
 
 #include <thread>
+#include <future>
 
 #include "metronome.hpp"
+#include "sampleindex.hpp"
+#include "waveformwidget.hpp"
 
 class MainWindow : public QMainWindow {
 Q_OBJECT
@@ -67,13 +72,54 @@ public slots:
 
     void selectSampleButtonPressed();
 
+    void selectBackingTrackButtonPressed();
+
+    void selectLibraryButtonPressed();
+
+    void librarySearchChanged(const QString &text);
+
+    void libraryItemActivated(QListWidgetItem *item);
+
 private:
+    /**
+     * @return The kit of the sample embedded by the asset pipeline.
+     */
+    static SampleKit defaultKit();
+
+    /**
+     * Load the kit in the background and report the result once it finished loading.
+     */
+    void loadKit(const SampleKit &kit, const QString &name);
+
+    /**
+     * Index the library at root in the background and show the updated index once it is done.
+     * A root requested while an update runs is indexed after it, only the most recent one if there are several.
+     */
+    void updateLibrary(const std::string &root);
+
+    /**
+     * Fill the library list with the samples matching the search text.
+     */
+    void showLibrary();
+
     Metronome metronome;
     QWidget *centralWidget;
     QPushButton *controlButton;
     QSpinBox *bpmSpinBox;
     QLabel *sampleLabel;
+    WaveformWidget *waveformWidget;
     QPushButton *selectSampleButton;
+    QLabel *backingTrackLabel;
+    QPushButton *selectBackingTrackButton;
+    QLabel *libraryLabel;
+    QPushButton *selectLibraryButton;
+    QLineEdit *librarySearchEdit;
+    QListWidget *libraryList;
+
+    std::shared_ptr<engine::SampleIndex> library; // Only replaced on the GUI thread
+    std::future<void> libraryUpdate;
+    bool libraryUpdating = false; // Cleared on the GUI thread once the result of the update is shown
+    std::string pendingLibraryRoot; // Requested while an update runs
 };
 
 #endif //METRONOME_MAINWINDOW_HPP
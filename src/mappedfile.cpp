@@ -0,0 +1,60 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "mappedfile.hpp"
+
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace engine {
+    MappedFile::MappedFile(const std::string &path, bool sequential) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open file at " + path + "\nError: " + std::strerror(errno));
+        }
+
+        struct stat st{};
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+            close(fd);
+            throw std::runtime_error("Cannot map file at " + path);
+        }
+
+        length = static_cast<size_t>(st.st_size);
+        void *ptr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (ptr == MAP_FAILED) {
+            throw std::runtime_error("Failed to map file at " + path + "\nError: " + std::strerror(errno));
+        }
+
+        if (sequential)
+            madvise(ptr, length, MADV_SEQUENTIAL);
+
+        mapping = static_cast<const uint8_t *>(ptr);
+    }
+
+    MappedFile::~MappedFile() {
+        munmap(const_cast<uint8_t *>(mapping), length);
+    }
+}
@@ -0,0 +1,62 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef METRONOME_MAPPEDFILE_HPP
+#define METRONOME_MAPPEDFILE_HPP
+
+#include <string>
+
+#include <cstdint>
+#include <cstddef>
+
+namespace engine {
+    /**
+     * Read-only memory mapping of a whole file.
+     *
+     * Reading the mapping of a file which is truncated meanwhile raises SIGBUS, so files which were just seen
+     * changing, like the sample files of a watched reload, are read with AudioLoadOptions::readFiles instead.
+     */
+    class MappedFile {
+    public:
+        /**
+         * @param sequential Advise the kernel that the mapping is going to be read front to back.
+         */
+        explicit MappedFile(const std::string &path, bool sequential = true);
+
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        const uint8_t *data() const {
+            return mapping;
+        }
+
+        size_t size() const {
+            return length;
+        }
+
+    private:
+        const uint8_t *mapping = nullptr;
+        size_t length = 0;
+    };
+}
+
+#endif //METRONOME_MAPPEDFILE_HPP
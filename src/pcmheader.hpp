@@ -0,0 +1,119 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef METRONOME_PCMHEADER_HPP
+#define METRONOME_PCMHEADER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include "audio/audiobuffer.hpp"
+#include "waveform.hpp"
+
+namespace engine {
+    /**
+     * The header of processed PCM stored by the sample cache and the asset pipeline, the data follows directly after it.
+     *
+     * A serialized waveform of waveformSize bytes may follow the PCM data.
+     */
+    struct PcmHeader {
+        static constexpr char MAGIC[4] = {'M', 'P', 'C', 'M'};
+        static const uint32_t VERSION = 1;
+
+        char magic[4];
+        uint32_t version;
+        uint32_t format;
+        uint32_t frequency;
+        uint64_t size;
+        float onset;
+        float peak;
+        float loudness;
+        float gain;
+        uint32_t waveformSize;
+        uint8_t padding[20]; // Keeps the PCM data aligned for vector loads
+
+        /**
+         * @param waveformSize The size of the serialized waveform of metadata which is stored after the data
+         */
+        static PcmHeader create(AudioFormat format,
+                                unsigned int frequency,
+                                size_t size,
+                                const AudioMetadata &metadata,
+                                size_t waveformSize = 0) {
+            PcmHeader ret{};
+            std::memcpy(ret.magic, MAGIC, sizeof(MAGIC));
+            ret.version = VERSION;
+            ret.format = static_cast<uint32_t>(format);
+            ret.frequency = frequency;
+            ret.size = size;
+            ret.onset = metadata.onset;
+            ret.peak = metadata.peak;
+            ret.loudness = metadata.loudness;
+            ret.gain = metadata.gain;
+            ret.waveformSize = static_cast<uint32_t>(waveformSize);
+            return ret;
+        }
+
+        /**
+         * @param size The size of data including the header
+         * @return False if data does not start with a valid header which matches the size.
+         */
+        static bool read(const void *data, size_t size, PcmHeader &header) {
+            if (size < sizeof(PcmHeader))
+                return false;
+            std::memcpy(&header, data, sizeof(PcmHeader));
+            return std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0
+                   && header.version == VERSION
+                   && header.size <= size - sizeof(PcmHeader)
+                   && header.waveformSize == size - sizeof(PcmHeader) - header.size
+                   && header.format <= BFORMAT3D_FLOAT32
+                   && header.frequency > 0;
+        }
+
+        AudioMetadata getMetadata() const {
+            AudioMetadata ret;
+            ret.onset = onset;
+            ret.peak = peak;
+            ret.loudness = loudness;
+            ret.gain = gain;
+            return ret;
+        }
+
+        /**
+         * @param data The data starting with this header
+         * @return The metadata including the waveform stored after the PCM data.
+         */
+        AudioMetadata getMetadata(const void *data) const {
+            auto ret = getMetadata();
+            Waveform waveform;
+            if (waveformSize > 0
+                && Waveform::deserialize(static_cast<const uint8_t *>(data) + sizeof(PcmHeader) + size,
+                                         waveformSize,
+                                         waveform)) {
+                ret.waveform = std::make_shared<const Waveform>(std::move(waveform));
+            }
+            return ret;
+        }
+    };
+
+    static_assert(sizeof(PcmHeader) == 64, "Unexpected PCM header size");
+}
+
+#endif //METRONOME_PCMHEADER_HPP
@@ -0,0 +1,99 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef METRONOME_RINGBUFFER_HPP
+#define METRONOME_RINGBUFFER_HPP
+
+#include <vector>
+#include <atomic>
+
+#include <cstddef>
+
+namespace engine {
+    /**
+     * Lock-free ring of preallocated slots for exactly one producer and one consumer thread.
+     *
+     * Slots are filled and drained in place: the producer obtains a free slot with beginWrite and publishes it
+     * with commitWrite, the consumer obtains the oldest published slot with beginRead and frees it with commitRead.
+     */
+    template<typename T>
+    class RingBuffer {
+    public:
+        /**
+         * @param capacity The number of slots, rounded up to a power of two.
+         * @param value The value every slot is initialized with.
+         */
+        explicit RingBuffer(size_t capacity, const T &value = T())
+                : slots(roundUp(capacity), value), mask(slots.size() - 1) {}
+
+        RingBuffer(const RingBuffer &) = delete;
+
+        RingBuffer &operator=(const RingBuffer &) = delete;
+
+        /**
+         * @return The next free slot or nullptr if the ring is full.
+         */
+        T *beginWrite() {
+            auto index = writeIndex.load(std::memory_order_relaxed);
+            if (index - readIndex.load(std::memory_order_acquire) >= slots.size())
+                return nullptr;
+            return &slots[index & mask];
+        }
+
+        void commitWrite() {
+            writeIndex.store(writeIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        /**
+         * @return The oldest published slot or nullptr if the ring is empty.
+         */
+        T *beginRead() {
+            auto index = readIndex.load(std::memory_order_relaxed);
+            if (writeIndex.load(std::memory_order_acquire) == index)
+                return nullptr;
+            return &slots[index & mask];
+        }
+
+        void commitRead() {
+            readIndex.store(readIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        bool isFull() const {
+            return writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_acquire)
+                   >= slots.size();
+        }
+
+    private:
+        static size_t roundUp(size_t value) {
+            size_t ret = 1;
+            while (ret < value)
+                ret <<= 1;
+            return ret;
+        }
+
+        std::vector<T> slots;
+        size_t mask;
+
+        // The indices only ever increase and are kept on separate cache lines to avoid false sharing.
+        alignas(64) std::atomic<size_t> writeIndex{0};
+        alignas(64) std::atomic<size_t> readIndex{0};
+    };
+}
+
+#endif //METRONOME_RINGBUFFER_HPP
@@ -0,0 +1,233 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "samplebank.hpp"
+#include "mappedfile.hpp"
+#include "pcmheader.hpp"
+
+#include <stdexcept>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace engine {
+    static const char BANK_MAGIC[4] = {'M', 'B', 'N', 'K'};
+    static const uint32_t BANK_VERSION = 1;
+    static const uint64_t BANK_ALIGNMENT = 4096;
+
+    struct BankHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t sampleCount;
+        uint32_t alignment;
+        uint64_t indexOffset;
+        uint64_t namesOffset;
+        uint64_t namesSize;
+        uint8_t padding[24];
+    };
+
+    struct BankEntry {
+        uint64_t offset; // The offset of the blob from the start of the file
+        uint64_t size; // The size of the blob including its PcmHeader
+        uint64_t nameOffset; // The offset of the name in the name table
+        uint64_t nameSize;
+        uint8_t padding[32];
+        PcmHeader header; // A copy of the header of the blob so that the index describes the sample on its own
+    };
+
+    static_assert(sizeof(BankHeader) == 64, "Unexpected bank header size");
+    static_assert(sizeof(BankEntry) == 128, "Unexpected bank entry size");
+
+    static uint64_t alignUp(uint64_t value) {
+        return (value + BANK_ALIGNMENT - 1) & ~(BANK_ALIGNMENT - 1);
+    }
+
+    static bool writeAll(int fd, const void *data, size_t size) {
+        auto *p = static_cast<const uint8_t *>(data);
+        while (size > 0) {
+            auto ret = ::write(fd, p, size);
+            if (ret < 0) {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            p += ret;
+            size -= static_cast<size_t>(ret);
+        }
+        return true;
+    }
+
+    void SampleBank::write(const std::string &path, const std::vector<Entry> &entries) {
+        std::vector<std::vector<uint8_t>> waveforms;
+        for (auto &entry: entries) {
+            auto &waveform = entry.audio.metadata.waveform;
+            waveforms.emplace_back(waveform ? waveform->serialize() : std::vector<uint8_t>());
+        }
+
+        BankHeader header{};
+        std::memcpy(header.magic, BANK_MAGIC, sizeof(BANK_MAGIC));
+        header.version = BANK_VERSION;
+        header.sampleCount = static_cast<uint32_t>(entries.size());
+        header.alignment = BANK_ALIGNMENT;
+        header.indexOffset = sizeof(BankHeader);
+        header.namesOffset = header.indexOffset + entries.size() * sizeof(BankEntry);
+
+        std::string names;
+        std::vector<BankEntry> index(entries.size());
+        for (size_t i = 0; i < entries.size(); i++) {
+            auto &audio = entries[i].audio;
+            auto &entry = index[i];
+            entry = BankEntry{};
+            entry.nameOffset = names.size();
+            entry.nameSize = entries[i].name.size();
+            entry.size = sizeof(PcmHeader) + audio.data.size() + waveforms[i].size();
+            entry.header = PcmHeader::create(audio.format,
+                                             audio.frequency,
+                                             audio.data.size(),
+                                             audio.metadata,
+                                             waveforms[i].size());
+            names += entries[i].name;
+        }
+        header.namesSize = names.size();
+
+        auto offset = alignUp(header.namesOffset + header.namesSize);
+        for (auto &entry: index) {
+            entry.offset = offset;
+            offset = alignUp(offset + entry.size);
+        }
+
+        // Write to a temporary file and rename it over the bank so that a mapped bank is never truncated.
+        auto temporaryPath = path + ".XXXXXX";
+        int fd = mkstemp(&temporaryPath[0]);
+        if (fd < 0)
+            throw std::runtime_error("Failed to write sample bank at " + path + "\nError: " + std::strerror(errno));
+        // mkstemp creates the file readable by the owner only.
+        fchmod(fd, 0644);
+
+        bool success = writeAll(fd, &header, sizeof(header))
+                       && writeAll(fd, index.data(), index.size() * sizeof(BankEntry))
+                       && writeAll(fd, names.data(), names.size());
+
+        uint64_t position = header.namesOffset + header.namesSize;
+        for (size_t i = 0; i < entries.size() && success; i++) {
+            auto &entry = index[i];
+            auto &data = entries[i].audio.data;
+            std::string padding(entry.offset - position, '\0');
+            success = writeAll(fd, padding.data(), padding.size())
+                      && writeAll(fd, &entry.header, sizeof(PcmHeader))
+                      && writeAll(fd, data.data(), data.size())
+                      && writeAll(fd, waveforms[i].data(), waveforms[i].size());
+            position = entry.offset + entry.size;
+        }
+
+        auto error = success ? 0 : errno;
+        if (close(fd) != 0 && success) {
+            success = false;
+            error = errno;
+        }
+        if (success && rename(temporaryPath.c_str(), path.c_str()) != 0) {
+            success = false;
+            error = errno;
+        }
+        if (success)
+            return;
+        unlink(temporaryPath.c_str());
+        throw std::runtime_error("Failed to write sample bank at " + path + "\nError: " + std::strerror(error));
+    }
+
+    SampleBank::SampleBank(const std::string &path)
+            : file(std::make_unique<MappedFile>(path, false)) {
+        auto *data = file->data();
+        auto size = file->size();
+
+        BankHeader header{};
+        if (size < sizeof(BankHeader))
+            throw std::runtime_error("Invalid sample bank at " + path);
+        std::memcpy(&header, data, sizeof(BankHeader));
+        if (std::memcmp(header.magic, BANK_MAGIC, sizeof(BANK_MAGIC)) != 0 || header.version != BANK_VERSION)
+            throw std::runtime_error("Invalid sample bank at " + path);
+        if (header.indexOffset > size
+            || header.sampleCount > (size - header.indexOffset) / sizeof(BankEntry)
+            || header.namesOffset > size
+            || header.namesSize > size - header.namesOffset)
+            throw std::runtime_error("Corrupt sample bank index at " + path);
+
+        auto *names = reinterpret_cast<const char *>(data + header.namesOffset);
+        samples.reserve(header.sampleCount);
+        for (size_t i = 0; i < header.sampleCount; i++) {
+            BankEntry entry{};
+            std::memcpy(&entry, data + header.indexOffset + i * sizeof(BankEntry), sizeof(BankEntry));
+
+            PcmHeader pcm{};
+            if (entry.offset > size
+                || entry.size > size - entry.offset
+                || entry.nameOffset > header.namesSize
+                || entry.nameSize > header.namesSize - entry.nameOffset
+                || !PcmHeader::read(&entry.header, entry.size, pcm))
+                throw std::runtime_error("Corrupt sample bank entry " + std::to_string(i) + " at " + path);
+
+            Sample sample;
+            sample.name.assign(names + entry.nameOffset, entry.nameSize);
+            sample.blob = data + entry.offset;
+            sample.blobSize = entry.size;
+            sample.format = static_cast<AudioFormat>(pcm.format);
+            sample.frequency = pcm.frequency;
+            sample.channels = getChannelCount(sample.format);
+            sample.frames = pcm.size / (sample.channels * getSampleSize(sample.format));
+            sample.metadata = pcm.getMetadata();
+            samples.emplace_back(std::move(sample));
+        }
+    }
+
+    SampleBank::~SampleBank() = default;
+
+    size_t SampleBank::find(const std::string &name) const {
+        for (size_t i = 0; i < samples.size(); i++) {
+            if (samples[i].name == name)
+                return i;
+        }
+        return samples.size();
+    }
+
+    std::shared_ptr<const Waveform> SampleBank::getWaveform(size_t index) const {
+        auto &sample = samples.at(index);
+        PcmHeader pcm{};
+        if (!PcmHeader::read(sample.blob, sample.blobSize, pcm))
+            return nullptr;
+        return pcm.getMetadata(sample.blob).waveform;
+    }
+
+    std::unique_ptr<AudioBuffer> SampleBank::upload(size_t index, AudioContext &context) const {
+        auto &sample = samples.at(index);
+        return loadAudioBufferPcm(sample.blob, sample.blobSize, context);
+    }
+
+    SampleKit::Sample SampleBank::getKitSample(size_t index) const {
+        auto &sample = samples.at(index);
+        SampleKit::Sample ret;
+        ret.memory = sample.blob;
+        ret.memorySize = sample.blobSize;
+        ret.pcm = true;
+        return ret;
+    }
+}
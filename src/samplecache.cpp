@@ -0,0 +1,290 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "samplecache.hpp"
+#include "pcmheader.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+#include <ctime>
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+namespace engine {
+    static const char *CACHE_EXTENSION = ".pcm";
+    static const char *TEMPORARY_PREFIX = ".entry-";
+
+    // Temporary files older than this are left over from a crashed writer, younger ones may still be written.
+    static const time_t STALE_TEMPORARY_AGE = 60 * 60;
+
+    static const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+    static const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+    static const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+    static const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+    static const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+    static uint64_t rotateLeft(uint64_t value, int bits) {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    static uint64_t read64(const uint8_t *data) {
+        uint64_t ret;
+        std::memcpy(&ret, data, sizeof(ret));
+        return ret;
+    }
+
+    static uint32_t read32(const uint8_t *data) {
+        uint32_t ret;
+        std::memcpy(&ret, data, sizeof(ret));
+        return ret;
+    }
+
+    static uint64_t hashRound(uint64_t accumulator, uint64_t input) {
+        accumulator += input * PRIME64_2;
+        accumulator = rotateLeft(accumulator, 31);
+        return accumulator * PRIME64_1;
+    }
+
+    static uint64_t hashMerge(uint64_t accumulator, uint64_t value) {
+        accumulator ^= hashRound(0, value);
+        return accumulator * PRIME64_1 + PRIME64_4;
+    }
+
+    // XXH64, which hashes at memory bandwidth using four independent lanes.
+    uint64_t SampleCache::hash(const void *data, size_t size, uint64_t seed) {
+        auto *p = static_cast<const uint8_t *>(data);
+        auto *end = p + size;
+        uint64_t ret;
+
+        if (size >= 32) {
+            uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+            uint64_t v2 = seed + PRIME64_2;
+            uint64_t v3 = seed;
+            uint64_t v4 = seed - PRIME64_1;
+            for (; p + 32 <= end; p += 32) {
+                v1 = hashRound(v1, read64(p));
+                v2 = hashRound(v2, read64(p + 8));
+                v3 = hashRound(v3, read64(p + 16));
+                v4 = hashRound(v4, read64(p + 24));
+            }
+            ret = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+            ret = hashMerge(ret, v1);
+            ret = hashMerge(ret, v2);
+            ret = hashMerge(ret, v3);
+            ret = hashMerge(ret, v4);
+        } else {
+            ret = seed + PRIME64_5;
+        }
+
+        ret += static_cast<uint64_t>(size);
+
+        for (; p + 8 <= end; p += 8) {
+            ret ^= hashRound(0, read64(p));
+            ret = rotateLeft(ret, 27) * PRIME64_1 + PRIME64_4;
+        }
+        if (p + 4 <= end) {
+            ret ^= static_cast<uint64_t>(read32(p)) * PRIME64_1;
+            ret = rotateLeft(ret, 23) * PRIME64_2 + PRIME64_3;
+            p += 4;
+        }
+        for (; p < end; p++) {
+            ret ^= *p * PRIME64_5;
+            ret = rotateLeft(ret, 11) * PRIME64_1;
+        }
+
+        ret ^= ret >> 33;
+        ret *= PRIME64_2;
+        ret ^= ret >> 29;
+        ret *= PRIME64_3;
+        ret ^= ret >> 32;
+        return ret;
+    }
+
+    std::string SampleCache::getDefaultDirectory() {
+        const char *cacheHome = std::getenv("XDG_CACHE_HOME");
+        if (cacheHome != nullptr && cacheHome[0] == '/')
+            return std::string(cacheHome) + "/metronome/samples";
+        const char *home = std::getenv("HOME");
+        if (home != nullptr && home[0] != 0)
+            return std::string(home) + "/.cache/metronome/samples";
+        return "";
+    }
+
+    static bool createDirectories(const std::string &path) {
+        for (size_t pos = path.find('/', 1); ; pos = path.find('/', pos + 1)) {
+            auto parent = path.substr(0, pos);
+            if (mkdir(parent.c_str(), 0755) != 0 && errno != EEXIST)
+                return false;
+            if (pos == std::string::npos)
+                return true;
+        }
+    }
+
+    static bool writeAll(int fd, const void *data, size_t size) {
+        auto *p = static_cast<const uint8_t *>(data);
+        while (size > 0) {
+            auto ret = write(fd, p, size);
+            if (ret < 0) {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            p += ret;
+            size -= static_cast<size_t>(ret);
+        }
+        return true;
+    }
+
+    SampleCache::SampleCache(std::string directory, size_t maximumSize)
+            : directory(std::move(directory)), maximumSize(maximumSize) {}
+
+    bool SampleCache::load(uint64_t key, Entry &entry) {
+        if (directory.empty())
+            return false;
+
+        auto path = getPath(key);
+        std::unique_ptr<MappedFile> file;
+        try {
+            file = std::make_unique<MappedFile>(path);
+        } catch (const std::exception &) {
+            return false;
+        }
+
+        PcmHeader header{};
+        if (!PcmHeader::read(file->data(), file->size(), header)) {
+            unlink(path.c_str());
+            return false;
+        }
+
+        // Mark the entry as recently used.
+        utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+
+        entry.data = file->data() + sizeof(PcmHeader);
+        entry.size = static_cast<size_t>(header.size);
+        entry.format = static_cast<AudioFormat>(header.format);
+        entry.frequency = header.frequency;
+        entry.metadata = header.getMetadata(file->data());
+        entry.file = std::move(file);
+        return true;
+    }
+
+    void SampleCache::store(uint64_t key,
+                            const void *data,
+                            size_t size,
+                            AudioFormat format,
+                            unsigned int frequency,
+                            const AudioMetadata &metadata) {
+        if (directory.empty() || size + sizeof(PcmHeader) > maximumSize)
+            return;
+        if (!createDirectories(directory))
+            return;
+
+        std::vector<uint8_t> waveform;
+        if (metadata.waveform)
+            waveform = metadata.waveform->serialize();
+        auto header = PcmHeader::create(format, frequency, size, metadata, waveform.size());
+
+        // Write to a temporary file and rename it so that readers never observe a partial entry.
+        auto temporaryPath = directory + "/" + TEMPORARY_PREFIX + "XXXXXX";
+        int fd = mkstemp(&temporaryPath[0]);
+        if (fd < 0)
+            return;
+        bool success = writeAll(fd, &header, sizeof(header))
+                       && writeAll(fd, data, size)
+                       && writeAll(fd, waveform.data(), waveform.size());
+        success = close(fd) == 0 && success;
+        if (!success || rename(temporaryPath.c_str(), getPath(key).c_str()) != 0)
+            unlink(temporaryPath.c_str());
+
+        evict();
+    }
+
+    std::string SampleCache::getPath(uint64_t key) const {
+        char name[17];
+        std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+        return directory + "/" + name + CACHE_EXTENSION;
+    }
+
+    void SampleCache::evict() {
+        struct File {
+            std::string path;
+            struct timespec modified;
+            size_t size;
+        };
+
+        DIR *dir = opendir(directory.c_str());
+        if (dir == nullptr)
+            return;
+
+        std::vector<File> files;
+        size_t totalSize = 0;
+        auto extensionLength = std::strlen(CACHE_EXTENSION);
+        auto prefixLength = std::strlen(TEMPORARY_PREFIX);
+        auto now = std::time(nullptr);
+        while (auto *ent = readdir(dir)) {
+            std::string name = ent->d_name;
+            if (name.compare(0, prefixLength, TEMPORARY_PREFIX) == 0) {
+                // Remove leftovers of interrupted stores and count the ones in progress against the maximum.
+                auto path = directory + "/" + name;
+                struct stat st{};
+                if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+                    continue;
+                if (now - st.st_mtim.tv_sec > STALE_TEMPORARY_AGE)
+                    unlink(path.c_str());
+                else
+                    totalSize += static_cast<size_t>(st.st_size);
+                continue;
+            }
+            if (name.size() <= extensionLength
+                || name.compare(name.size() - extensionLength, extensionLength, CACHE_EXTENSION) != 0)
+                continue;
+            File file{directory + "/" + name, {}, 0};
+            struct stat st{};
+            if (stat(file.path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+                continue;
+            file.modified = st.st_mtim;
+            file.size = static_cast<size_t>(st.st_size);
+            totalSize += file.size;
+            files.emplace_back(std::move(file));
+        }
+        closedir(dir);
+
+        if (totalSize <= maximumSize)
+            return;
+
+        std::sort(files.begin(), files.end(), [](const File &a, const File &b) {
+            if (a.modified.tv_sec != b.modified.tv_sec)
+                return a.modified.tv_sec < b.modified.tv_sec;
+            return a.modified.tv_nsec < b.modified.tv_nsec;
+        });
+        for (auto &file: files) {
+            if (totalSize <= maximumSize)
+                break;
+            if (unlink(file.path.c_str()) == 0)
+                totalSize -= file.size;
+        }
+    }
+}
@@ -0,0 +1,95 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef METRONOME_SAMPLECACHE_HPP
+#define METRONOME_SAMPLECACHE_HPP
+
+#include <string>
+#include <memory>
+
+#include <cstdint>
+#include <cstddef>
+
+#include "audio/audiobuffer.hpp"
+
+#include "mappedfile.hpp"
+
+namespace engine {
+    /**
+     * Persistent cache of processed sample PCM keyed by a hash of the encoded data and the processing parameters.
+     *
+     * Every entry is a single file holding a fixed size header followed by the PCM and the waveform pyramid
+     * of the metadata, hits are memory mapped.
+     * The least recently used entries are removed when the total size exceeds the maximum.
+     */
+    class SampleCache {
+    public:
+        struct Entry {
+            std::unique_ptr<MappedFile> file; // Keeps the data mapped
+            const uint8_t *data = nullptr;
+            size_t size = 0;
+            AudioFormat format = MONO16;
+            unsigned int frequency = 0;
+            AudioMetadata metadata;
+        };
+
+        /**
+         * @return The metronome directory in the XDG cache directory.
+         */
+        static std::string getDefaultDirectory();
+
+        /**
+         * @return A 64 bit hash of the data, seed allows to fold in additional parameters.
+         */
+        static uint64_t hash(const void *data, size_t size, uint64_t seed = 0);
+
+        /**
+         * @param directory The directory to store entries in, created on the first store.
+         * @param maximumSize The maximum combined size of all entries in bytes.
+         */
+        explicit SampleCache(std::string directory = getDefaultDirectory(),
+                             size_t maximumSize = 256 * 1024 * 1024);
+
+        /**
+         * @return False if there is no valid entry for key.
+         */
+        bool load(uint64_t key, Entry &entry);
+
+        /**
+         * Write an entry and evict the least recently used entries if the cache grew too large.
+         * Failures are ignored because the cache is only an optimization.
+         */
+        void store(uint64_t key,
+                   const void *data,
+                   size_t size,
+                   AudioFormat format,
+                   unsigned int frequency,
+                   const AudioMetadata &metadata);
+
+    private:
+        std::string getPath(uint64_t key) const;
+
+        void evict();
+
+        std::string directory;
+        size_t maximumSize;
+    };
+}
+
+#endif //METRONOME_SAMPLECACHE_HPP
@@ -0,0 +1,367 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "sampleindex.hpp"
+#include "audioloader.hpp"
+#include "threadpool.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <cerrno>
+#include <set>
+#include <utility>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <sndfile.h>
+
+namespace engine {
+    static const char INDEX_MAGIC[4] = {'M', 'I', 'D', 'X'};
+    static const uint32_t INDEX_VERSION = 1;
+
+    struct IndexHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t rootSize; // The root directory follows the header
+    };
+
+    // Every record is followed by its path.
+    struct IndexRecord {
+        int64_t modified;
+        uint64_t size;
+        int32_t format;
+        int32_t channels;
+        int32_t frequency;
+        uint32_t pathSize;
+        double duration;
+        float onset;
+        float loudness;
+    };
+
+    static_assert(sizeof(IndexRecord) == 48, "Unexpected index record size");
+
+    struct IndexFile {
+        std::string path; // Relative to the root directory
+        int64_t modified;
+        uint64_t size;
+    };
+
+    static bool createDirectories(const std::string &path) {
+        for (size_t pos = path.find('/', 1); ; pos = path.find('/', pos + 1)) {
+            auto parent = path.substr(0, pos);
+            if (mkdir(parent.c_str(), 0755) != 0 && errno != EEXIST)
+                return false;
+            if (pos == std::string::npos)
+                return true;
+        }
+    }
+
+    /**
+     * @param visited The directories listed so far, symbolic links which lead back into them are not followed again.
+     */
+    static void listFiles(const std::string &directory,
+                          const std::string &prefix,
+                          std::vector<IndexFile> &files,
+                          std::set<std::pair<dev_t, ino_t>> &visited) {
+        struct stat info{};
+        if (stat(directory.c_str(), &info) != 0 || !visited.emplace(info.st_dev, info.st_ino).second)
+            return;
+        DIR *dir = opendir(directory.c_str());
+        if (dir == nullptr)
+            return;
+        while (auto *ent = readdir(dir)) {
+            std::string name = ent->d_name;
+            if (name.empty() || name[0] == '.')
+                continue;
+            auto path = directory + "/" + name;
+            struct stat st{};
+            if (stat(path.c_str(), &st) != 0)
+                continue;
+            if (S_ISDIR(st.st_mode)) {
+                listFiles(path, prefix + name + "/", files, visited);
+            } else if (S_ISREG(st.st_mode)) {
+                files.emplace_back(IndexFile{prefix + name,
+                                             static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000
+                                             + st.st_mtim.tv_nsec,
+                                             static_cast<uint64_t>(st.st_size)});
+            }
+        }
+        closedir(dir);
+    }
+
+    /**
+     * Read the properties of the file, the format stays zero if it is not audio.
+     */
+    static void analyze(const std::string &path, SampleIndex::Entry &entry) {
+        // Opening only reads the header, so files which are not audio are rejected without reading them whole.
+        SF_INFO sfinfo{};
+        SNDFILE *sndfile = sf_open(path.c_str(), SFM_READ, &sfinfo);
+        if (!sndfile)
+            return;
+        sf_close(sndfile);
+
+        // The onset and loudness are measured like for loading, without changing the sample.
+        AudioLoadOptions options;
+        DecodedAudio audio;
+        try {
+            audio = decodeAudioFile(path, 0, options);
+        } catch (const std::exception &) {
+            return;
+        }
+
+        entry.format = audio.sourceFormat;
+        entry.channels = audio.sourceChannels;
+        entry.frequency = static_cast<int>(audio.sourceFrequency);
+        entry.duration = audio.sourceFrequency > 0
+                         ? static_cast<double>(audio.sourceFrames) / static_cast<double>(audio.sourceFrequency)
+                         : 0;
+        entry.onset = audio.metadata.onset;
+        entry.loudness = audio.metadata.loudness;
+    }
+
+    static std::string toLower(std::string value) {
+        std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) {
+            return static_cast<char>(std::tolower(c));
+        });
+        return value;
+    }
+
+    std::string SampleIndex::getDefaultPath() {
+        const char *dataHome = std::getenv("XDG_DATA_HOME");
+        if (dataHome != nullptr && dataHome[0] == '/')
+            return std::string(dataHome) + "/metronome/library.index";
+        const char *home = std::getenv("HOME");
+        if (home != nullptr && home[0] != 0)
+            return std::string(home) + "/.local/share/metronome/library.index";
+        return "";
+    }
+
+    std::string SampleIndex::getFormatName(int format) {
+        SF_FORMAT_INFO type{};
+        type.format = format & SF_FORMAT_TYPEMASK;
+        SF_FORMAT_INFO subtype{};
+        subtype.format = format & SF_FORMAT_SUBMASK;
+        if (sf_command(nullptr, SFC_GET_FORMAT_INFO, &type, sizeof(type)) != 0 || type.name == nullptr)
+            return "Unknown";
+        if (sf_command(nullptr, SFC_GET_FORMAT_INFO, &subtype, sizeof(subtype)) != 0 || subtype.name == nullptr)
+            return type.name;
+        return std::string(type.name) + ", " + subtype.name;
+    }
+
+    SampleIndex::SampleIndex(std::string path)
+            : path(std::move(path)) {
+        if (this->path.empty())
+            return;
+
+        std::ifstream stream(this->path, std::ios::binary);
+        std::vector<char> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+        IndexHeader header{};
+        if (data.size() < sizeof(header))
+            return;
+        std::memcpy(&header, data.data(), sizeof(header));
+        if (std::memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0
+            || header.version != INDEX_VERSION
+            || header.rootSize > data.size() - sizeof(header))
+            return;
+
+        size_t offset = sizeof(header);
+        std::string indexRoot(data.data() + offset, header.rootSize);
+        offset += header.rootSize;
+
+        std::vector<Entry> indexEntries;
+        indexEntries.reserve(std::min<size_t>(header.entryCount, data.size() / sizeof(IndexRecord)));
+        for (uint32_t i = 0; i < header.entryCount; i++) {
+            IndexRecord record{};
+            if (data.size() - offset < sizeof(record))
+                return;
+            std::memcpy(&record, data.data() + offset, sizeof(record));
+            offset += sizeof(record);
+            if (data.size() - offset < record.pathSize)
+                return;
+
+            Entry entry;
+            entry.path.assign(data.data() + offset, record.pathSize);
+            offset += record.pathSize;
+            entry.modified = record.modified;
+            entry.size = record.size;
+            entry.format = record.format;
+            entry.channels = record.channels;
+            entry.frequency = record.frequency;
+            entry.duration = record.duration;
+            entry.onset = record.onset;
+            entry.loudness = record.loudness;
+            indexEntries.emplace_back(std::move(entry));
+        }
+
+        root = std::move(indexRoot);
+        entries = std::move(indexEntries);
+    }
+
+    void SampleIndex::update(const std::string &directory, const std::function<void(size_t, size_t)> &progress) {
+        std::vector<IndexFile> files;
+        std::set<std::pair<dev_t, ino_t>> visited;
+        listFiles(directory, "", files, visited);
+        std::sort(files.begin(), files.end(), [](const IndexFile &a, const IndexFile &b) {
+            return a.path < b.path;
+        });
+
+        if (directory != root)
+            entries.clear();
+
+        // Both lists are sorted by path, so unchanged entries are found in a single merge pass.
+        std::vector<Entry> updated(files.size());
+        std::vector<size_t> changed;
+        auto previous = entries.begin();
+        for (size_t i = 0; i < files.size(); i++) {
+            auto &file = files[i];
+            while (previous != entries.end() && previous->path < file.path)
+                previous++;
+            if (previous != entries.end()
+                && previous->path == file.path
+                && previous->modified == file.modified
+                && previous->size == file.size) {
+                updated[i] = *previous;
+            } else {
+                updated[i].path = file.path;
+                updated[i].modified = file.modified;
+                updated[i].size = file.size;
+                changed.emplace_back(i);
+            }
+        }
+
+        if (!changed.empty()) {
+            ThreadPool pool;
+            std::mutex mutex;
+            std::condition_variable condition;
+            size_t analyzed = 0;
+            for (auto index: changed) {
+                pool.submit([&, index]() {
+                    analyze(directory + "/" + updated[index].path, updated[index]);
+                    std::lock_guard<std::mutex> guard(mutex);
+                    analyzed++;
+                    condition.notify_one();
+                });
+            }
+
+            std::unique_lock<std::mutex> guard(mutex);
+            size_t reported = 0;
+            while (reported < changed.size()) {
+                condition.wait(guard, [&]() { return analyzed > reported; });
+                reported = analyzed;
+                if (progress) {
+                    guard.unlock();
+                    progress(reported, changed.size());
+                    guard.lock();
+                }
+            }
+        }
+
+        root = directory;
+        entries = std::move(updated);
+    }
+
+    void SampleIndex::save() const {
+        if (path.empty())
+            throw std::runtime_error("No sample index path");
+
+        auto separator = path.find_last_of('/');
+        if (separator != std::string::npos && separator > 0 && !createDirectories(path.substr(0, separator)))
+            throw std::runtime_error("Failed to create the directory of the sample index at " + path);
+
+        IndexHeader header{};
+        std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+        header.version = INDEX_VERSION;
+        header.entryCount = static_cast<uint32_t>(entries.size());
+        header.rootSize = static_cast<uint32_t>(root.size());
+
+        // Write to a temporary file and rename it so that a crash never leaves a truncated index.
+        auto temporaryPath = path + ".tmp";
+        {
+            std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+            stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            stream.write(root.data(), static_cast<std::streamsize>(root.size()));
+            for (auto &entry: entries) {
+                IndexRecord record{};
+                record.modified = entry.modified;
+                record.size = entry.size;
+                record.format = entry.format;
+                record.channels = entry.channels;
+                record.frequency = entry.frequency;
+                record.pathSize = static_cast<uint32_t>(entry.path.size());
+                record.duration = entry.duration;
+                record.onset = entry.onset;
+                record.loudness = entry.loudness;
+                stream.write(reinterpret_cast<const char *>(&record), sizeof(record));
+                stream.write(entry.path.data(), static_cast<std::streamsize>(entry.path.size()));
+            }
+            if (!stream) {
+                stream.close();
+                unlink(temporaryPath.c_str());
+                throw std::runtime_error("Failed to write the sample index at " + path);
+            }
+        }
+        if (rename(temporaryPath.c_str(), path.c_str()) != 0) {
+            unlink(temporaryPath.c_str());
+            throw std::runtime_error("Failed to write the sample index at " + path);
+        }
+    }
+
+    std::vector<const SampleIndex::Entry *> SampleIndex::search(const std::string &query) const {
+        std::vector<std::string> terms;
+        size_t pos = 0;
+        while (pos < query.size()) {
+            auto begin = query.find_first_not_of(" \t", pos);
+            if (begin == std::string::npos)
+                break;
+            auto end = query.find_first_of(" \t", begin);
+            if (end == std::string::npos)
+                end = query.size();
+            terms.emplace_back(toLower(query.substr(begin, end - begin)));
+            pos = end;
+        }
+
+        std::vector<const Entry *> ret;
+        for (auto &entry: entries) {
+            if (entry.format == 0)
+                continue;
+            auto name = toLower(entry.path);
+            bool match = true;
+            for (auto &term: terms) {
+                if (name.find(term) == std::string::npos) {
+                    match = false;
+                    break;
+                }
+            }
+            if (match)
+                ret.emplace_back(&entry);
+        }
+        return ret;
+    }
+}
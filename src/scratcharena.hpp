@@ -0,0 +1,122 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef METRONOME_SCRATCHARENA_HPP
+#define METRONOME_SCRATCHARENA_HPP
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <new>
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+
+namespace engine {
+    /**
+     * Bump allocator for the temporary buffers of a load.
+     *
+     * Allocations stay valid until the next reset, after which the memory is reused.
+     * All blocks are merged into a single block on reset so that a warmed up arena serves a load from one allocation.
+     */
+    class ScratchArena {
+    public:
+        static const size_t ALIGNMENT = 64;
+
+        ScratchArena() = default;
+
+        ScratchArena(const ScratchArena &) = delete;
+
+        ScratchArena &operator=(const ScratchArena &) = delete;
+
+        ScratchArena(ScratchArena &&) = default;
+
+        ScratchArena &operator=(ScratchArena &&) = default;
+
+        template<typename T>
+        T *allocate(size_t count) {
+            return static_cast<T *>(allocateBytes(count * sizeof(T)));
+        }
+
+        void *allocateBytes(size_t size) {
+            size = alignUp(std::max<size_t>(size, 1));
+            if (blocks.empty() || blocks.back().size - offset < size) {
+                size_t blockSize = std::max(size, blocks.empty() ? size : blocks.back().size * 2);
+                blocks.emplace_back(blockSize);
+                offset = 0;
+            }
+            auto *ret = blocks.back().data.get() + offset;
+            offset += size;
+            used += size;
+            return ret;
+        }
+
+        /**
+         * Invalidate all allocations.
+         *
+         * @param maximumCapacity Release the memory instead of keeping it if more than this many bytes were used.
+         */
+        void reset(size_t maximumCapacity = SIZE_MAX) {
+            if (used > maximumCapacity) {
+                blocks.clear();
+            } else if (blocks.size() > 1) {
+                blocks.clear();
+                blocks.emplace_back(used);
+            }
+            offset = 0;
+            used = 0;
+        }
+
+        size_t capacity() const {
+            size_t ret = 0;
+            for (auto &block: blocks)
+                ret += block.size;
+            return ret;
+        }
+
+    private:
+        struct Deleter {
+            void operator()(uint8_t *ptr) const {
+                std::free(ptr);
+            }
+        };
+
+        struct Block {
+            std::unique_ptr<uint8_t, Deleter> data;
+            size_t size;
+
+            explicit Block(size_t size)
+                    : data(static_cast<uint8_t *>(std::aligned_alloc(ALIGNMENT, alignUp(size)))), size(alignUp(size)) {
+                if (!data)
+                    throw std::bad_alloc();
+            }
+        };
+
+        static size_t alignUp(size_t size) {
+            return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        }
+
+        std::vector<Block> blocks;
+        size_t offset = 0;
+        size_t used = 0;
+    };
+}
+
+#endif //METRONOME_SCRATCHARENA_HPP
@@ -0,0 +1,118 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "threadpool.hpp"
+
+#include <algorithm>
+
+namespace engine {
+    // The pool and worker index of the current thread if it is a worker.
+    static thread_local const ThreadPool *currentPool = nullptr;
+    static thread_local size_t currentWorker = SIZE_MAX;
+
+    ThreadPool::ThreadPool(size_t threads) {
+        if (threads == 0)
+            threads = std::max(std::thread::hardware_concurrency(), 1u);
+        for (size_t i = 0; i < threads; i++) {
+            workers.emplace_back(std::make_unique<Worker>());
+        }
+        for (size_t i = 0; i < threads; i++) {
+            workers[i]->thread = std::thread([this, i]() { run(i); });
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            running = false;
+        }
+        condition.notify_all();
+        for (auto &worker: workers)
+            worker->thread.join();
+    }
+
+    void ThreadPool::submit(std::function<void()> job) {
+        size_t index;
+        if (currentPool == this)
+            index = currentWorker;
+        else
+            index = nextWorker++ % workers.size();
+
+        // Counted before it is published, otherwise a worker could take the job and decrement queued first.
+        // A worker which sees the count before the job is in the queue retries until it is.
+        queued++;
+        try {
+            std::lock_guard<std::mutex> guard(workers[index]->mutex);
+            workers[index]->jobs.emplace_back(std::move(job));
+        } catch (...) {
+            queued--;
+            throw;
+        }
+        // A worker increments sleeping before it checks queued under the mutex, so either it sees the job
+        // or it is waiting by the time the mutex is acquired here.
+        if (sleeping > 0) {
+            std::lock_guard<std::mutex> guard(mutex);
+            condition.notify_one();
+        }
+    }
+
+    bool ThreadPool::pop(size_t index, std::function<void()> &job) {
+        {
+            auto &own = *workers[index];
+            std::lock_guard<std::mutex> guard(own.mutex);
+            if (!own.jobs.empty()) {
+                job = std::move(own.jobs.back());
+                own.jobs.pop_back();
+                queued--;
+                return true;
+            }
+        }
+        for (size_t i = 1; i < workers.size(); i++) {
+            auto &victim = *workers[(index + i) % workers.size()];
+            std::lock_guard<std::mutex> guard(victim.mutex);
+            if (!victim.jobs.empty()) {
+                job = std::move(victim.jobs.front());
+                victim.jobs.pop_front();
+                queued--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void ThreadPool::run(size_t index) {
+        currentPool = this;
+        currentWorker = index;
+        while (true) {
+            std::function<void()> job;
+            if (pop(index, job)) {
+                job();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> guard(mutex);
+            sleeping++;
+            condition.wait(guard, [this]() { return queued > 0 || !running; });
+            sleeping--;
+            // The remaining jobs are finished before the pool shuts down.
+            if (!running && queued == 0)
+                return;
+        }
+    }
+}
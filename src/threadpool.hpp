@@ -0,0 +1,85 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef METRONOME_THREADPOOL_HPP
+#define METRONOME_THREADPOOL_HPP
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+namespace engine {
+    /**
+     * Work stealing thread pool.
+     *
+     * Every worker owns a queue which it processes newest first, idle workers steal the oldest jobs of the others.
+     * Jobs submitted from a worker go to its own queue, other submissions are distributed round robin.
+     * Workers only take the shared mutex to go to sleep once every queue is empty, and submissions only
+     * take it to wake a sleeping worker.
+     */
+    class ThreadPool {
+    public:
+        /**
+         * @param threads The number of workers, zero uses one per hardware thread.
+         */
+        explicit ThreadPool(size_t threads = 0);
+
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        /**
+         * Queue a job for execution on a worker, jobs must not throw.
+         */
+        void submit(std::function<void()> job);
+
+        size_t getThreadCount() const {
+            return workers.size();
+        }
+
+    private:
+        struct Worker {
+            std::mutex mutex;
+            std::deque<std::function<void()>> jobs;
+            std::thread thread;
+        };
+
+        bool pop(size_t index, std::function<void()> &job);
+
+        void run(size_t index);
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::atomic<size_t> nextWorker{0};
+        std::atomic<size_t> queued{0}; // The number of jobs in all queues, including ones being submitted
+        std::atomic<size_t> sleeping{0}; // The number of workers waiting on the condition
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool running = true; // Guarded by the mutex
+    };
+}
+
+#endif //METRONOME_THREADPOOL_HPP
@@ -0,0 +1,143 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "waveform.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace engine {
+    struct SerializedWaveform {
+        uint64_t frames;
+        uint64_t offset;
+        uint64_t blocks;
+    };
+
+    static Waveform::Bin merge(const Waveform::Bin &a, const Waveform::Bin &b) {
+        Waveform::Bin ret;
+        ret.minimum = std::min(a.minimum, b.minimum);
+        ret.maximum = std::max(a.maximum, b.maximum);
+        ret.power = (a.power + b.power) / 2;
+        return ret;
+    }
+
+    Waveform::Waveform(std::vector<Bin> blocks, size_t frames)
+            : frames(frames) {
+        levels.emplace_back(std::move(blocks));
+        buildLevels();
+    }
+
+    void Waveform::scale(float gain) {
+        for (auto &level: levels) {
+            for (auto &bin: level) {
+                bin.minimum *= gain;
+                bin.maximum *= gain;
+                bin.power *= gain * gain;
+            }
+        }
+    }
+
+    void Waveform::trim(size_t count) {
+        offset += std::min(count, getFrameCount());
+    }
+
+    std::vector<Waveform::Bin> Waveform::getBins(size_t start, size_t end, size_t count) const {
+        std::vector<Bin> ret(count);
+        end = std::min(end, getFrameCount());
+        if (count == 0 || start >= end || levels.empty())
+            return ret;
+
+        auto length = end - start;
+        start += offset;
+
+        // The coarsest level with bins no longer than an output bin.
+        size_t level = 0;
+        while (level + 1 < levels.size() && (BLOCK_FRAMES << (level + 1)) * count <= length)
+            level++;
+
+        auto &bins = levels[level];
+        auto width = BLOCK_FRAMES << level;
+        for (size_t i = 0; i < count; i++) {
+            auto from = start + length * i / count;
+            auto to = start + length * (i + 1) / count;
+            auto first = from / width;
+            auto last = std::max(first + 1, (to + width - 1) / width);
+            last = std::min(last, bins.size());
+            if (first >= last)
+                continue;
+            Bin bin = bins[first];
+            float power = 0;
+            for (auto j = first; j < last; j++) {
+                bin.minimum = std::min(bin.minimum, bins[j].minimum);
+                bin.maximum = std::max(bin.maximum, bins[j].maximum);
+                power += bins[j].power;
+            }
+            bin.power = power / static_cast<float>(last - first);
+            ret[i] = bin;
+        }
+        return ret;
+    }
+
+    std::vector<uint8_t> Waveform::serialize() const {
+        SerializedWaveform header{};
+        header.frames = frames;
+        header.offset = offset;
+        header.blocks = levels.empty() ? 0 : levels.front().size();
+
+        std::vector<uint8_t> ret(sizeof(header) + header.blocks * sizeof(Bin));
+        std::memcpy(ret.data(), &header, sizeof(header));
+        if (header.blocks > 0)
+            std::memcpy(ret.data() + sizeof(header), levels.front().data(), header.blocks * sizeof(Bin));
+        return ret;
+    }
+
+    bool Waveform::deserialize(const void *data, size_t size, Waveform &waveform) {
+        SerializedWaveform header{};
+        if (size < sizeof(header))
+            return false;
+        std::memcpy(&header, data, sizeof(header));
+        if (header.blocks != (size - sizeof(header)) / sizeof(Bin)
+            || size != sizeof(header) + header.blocks * sizeof(Bin)
+            || header.offset > header.frames
+            || header.blocks != (header.frames + BLOCK_FRAMES - 1) / BLOCK_FRAMES)
+            return false;
+
+        // Only the blocks are stored, the coarser levels are cheap to rebuild.
+        std::vector<Bin> blocks(header.blocks);
+        if (header.blocks > 0)
+            std::memcpy(blocks.data(), static_cast<const uint8_t *>(data) + sizeof(header), header.blocks * sizeof(Bin));
+        waveform = Waveform(std::move(blocks), header.frames);
+        waveform.offset = header.offset;
+        return true;
+    }
+
+    void Waveform::buildLevels() {
+        while (levels.back().size() > 1) {
+            auto &previous = levels.back();
+            std::vector<Bin> level((previous.size() + 1) / 2);
+            for (size_t i = 0; i < level.size(); i++) {
+                if (i * 2 + 1 < previous.size())
+                    level[i] = merge(previous[i * 2], previous[i * 2 + 1]);
+                else
+                    level[i] = previous[i * 2];
+            }
+            levels.emplace_back(std::move(level));
+        }
+    }
+}
@@ -0,0 +1,63 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "waveformwidget.hpp"
+
+#include <QPainter>
+
+#include <cmath>
+
+WaveformWidget::WaveformWidget(QWidget *parent)
+        : QWidget(parent) {
+    setMinimumHeight(48);
+}
+
+void WaveformWidget::setWaveform(std::shared_ptr<const engine::Waveform> value) {
+    waveform = std::move(value);
+    update();
+}
+
+QSize WaveformWidget::sizeHint() const {
+    return QSize(400, 64);
+}
+
+void WaveformWidget::paintEvent(QPaintEvent *) {
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor(32, 32, 32));
+
+    if (!waveform || width() <= 0)
+        return;
+
+    auto bins = waveform->getBins(0, waveform->getFrameCount(), static_cast<size_t>(width()));
+    auto center = height() / 2;
+    auto scale = static_cast<float>(height()) / 2;
+
+    // The peak envelope with the RMS level drawn on top of it.
+    painter.setPen(QColor(80, 140, 200));
+    for (int x = 0; x < width(); x++) {
+        auto &bin = bins[static_cast<size_t>(x)];
+        painter.drawLine(x, center - static_cast<int>(bin.maximum * scale),
+                         x, center - static_cast<int>(bin.minimum * scale));
+    }
+    painter.setPen(QColor(160, 210, 250));
+    for (int x = 0; x < width(); x++) {
+        auto rms = static_cast<int>(std::sqrt(bins[static_cast<size_t>(x)].power) * scale);
+        painter.drawLine(x, center - rms, x, center + rms);
+    }
+}
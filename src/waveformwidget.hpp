@@ -0,0 +1,50 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef METRONOME_WAVEFORMWIDGET_HPP
+#define METRONOME_WAVEFORMWIDGET_HPP
+
+#include <QWidget>
+
+#include <memory>
+
+#include "waveform.hpp"
+
+/**
+ * Draws the waveform pyramid of a sample, the cost of a repaint depends only on the width of the widget.
+ */
+class WaveformWidget : public QWidget {
+public:
+    explicit WaveformWidget(QWidget *parent = nullptr);
+
+    /**
+     * @param waveform The waveform to draw or null to clear the widget.
+     */
+    void setWaveform(std::shared_ptr<const engine::Waveform> waveform);
+
+    QSize sizeHint() const override;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    std::shared_ptr<const engine::Waveform> waveform;
+};
+
+#endif //METRONOME_WAVEFORMWIDGET_HPP
@@ -0,0 +1,75 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef METRONOME_CHECK_HPP
+#define METRONOME_CHECK_HPP
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+
+#include <unistd.h>
+#include <ftw.h>
+
+// Unlike assert the checks also run in release builds, which are the ones the SIMD kernels are tuned for.
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::fprintf(stderr, "%s:%d: Check failed: %s\n", __FILE__, __LINE__, #condition); \
+            std::exit(1); \
+        } \
+    } while (false)
+
+#define CHECK_NEAR(a, b, tolerance) CHECK(std::abs(static_cast<double>(a) - static_cast<double>(b)) <= (tolerance))
+
+/**
+ * A directory below the temporary directory which is removed with its files when the test ends.
+ */
+class TemporaryDirectory {
+public:
+    TemporaryDirectory() {
+        const char *base = std::getenv("TMPDIR");
+        std::string pattern = std::string(base != nullptr && base[0] != 0 ? base : "/tmp") + "/metronome-test-XXXXXX";
+        if (mkdtemp(&pattern[0]) == nullptr) {
+            std::fprintf(stderr, "Failed to create a temporary directory\n");
+            std::exit(1);
+        }
+        path = pattern;
+    }
+
+    ~TemporaryDirectory() {
+        nftw(path.c_str(), [](const char *entry, const struct stat *, int, struct FTW *) {
+            return std::remove(entry);
+        }, 16, FTW_DEPTH | FTW_PHYS);
+    }
+
+    TemporaryDirectory(const TemporaryDirectory &) = delete;
+
+    TemporaryDirectory &operator=(const TemporaryDirectory &) = delete;
+
+    const std::string &getPath() const {
+        return path;
+    }
+
+private:
+    std::string path;
+};
+
+#endif //METRONOME_CHECK_HPP
@@ -0,0 +1,109 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "audio/audiodevice.hpp"
+#include "audio/openal/oalaudiobuffer.hpp"
+
+#include "check.hpp"
+
+#include <stdexcept>
+#include <vector>
+
+using namespace engine;
+
+// ctest reports the test as skipped instead of failed on machines without an audio device.
+static const int SKIP_RETURN_CODE = 77;
+
+static const size_t FRAMES = 64;
+
+static bool tryUpdate(AudioBuffer &buffer, const std::vector<int16_t> &samples, size_t offset, size_t length) {
+    try {
+        buffer.update(samples.data(), samples.size() * sizeof(int16_t), offset, length);
+        return true;
+    } catch (const std::runtime_error &) {
+        return false;
+    }
+}
+
+static void testUpdate(AudioContext &context) {
+    std::vector<int16_t> samples(FRAMES, 0);
+    auto buffer = context.createBuffer();
+    buffer->upload(samples.data(), samples.size() * sizeof(int16_t), MONO16, 44100);
+
+    // Every backend updates a buffer which no source uses.
+    for (size_t i = 16; i < 32; i++)
+        samples[i] = 1000;
+    CHECK(tryUpdate(*buffer, samples, 16 * sizeof(int16_t), 16 * sizeof(int16_t)));
+    CHECK(tryUpdate(*buffer, samples, 0, 0));
+
+    CHECK(!tryUpdate(*buffer, samples, 1, sizeof(int16_t)));
+    CHECK(!tryUpdate(*buffer, samples, 0, sizeof(int16_t) + 1));
+    CHECK(!tryUpdate(*buffer, samples, FRAMES * sizeof(int16_t), sizeof(int16_t)));
+
+    std::vector<int16_t> shorter(FRAMES - 1, 0);
+    CHECK(!tryUpdate(*buffer, shorter, 0, sizeof(int16_t)));
+}
+
+static void testUpdateAttached(AudioContext &context) {
+    std::vector<int16_t> samples(FRAMES, 0);
+    auto source = context.createSource();
+
+    // The buffers of the context replace ranges in place when the extension is available.
+    auto buffer = context.createBuffer();
+    buffer->upload(samples.data(), samples.size() * sizeof(int16_t), MONO16, 44100);
+    source->setBuffer(*buffer);
+    samples[0] = 1000;
+    CHECK(tryUpdate(*buffer, samples, 0, sizeof(int16_t)) == alIsExtensionPresent("AL_SOFT_buffer_sub_data"));
+    source->clearBuffer();
+    CHECK(tryUpdate(*buffer, samples, 0, sizeof(int16_t)));
+
+    // Without the extension the buffer is uploaded whole, which OpenAL refuses while a source uses it.
+    ALuint handle;
+    alGenBuffers(1, &handle);
+    CHECK(alGetError() == AL_NO_ERROR);
+    OALAudioBuffer fallback(handle);
+    fallback.upload(samples.data(), samples.size() * sizeof(int16_t), MONO16, 44100);
+    source->setBuffer(fallback);
+    samples[1] = 1000;
+    try {
+        fallback.update(samples.data(), samples.size() * sizeof(int16_t), sizeof(int16_t), sizeof(int16_t));
+        CHECK(false);
+    } catch (const std::runtime_error &e) {
+        CHECK(std::string(e.what()).find("AL_SOFT_buffer_sub_data") != std::string::npos);
+    }
+    source->clearBuffer();
+    CHECK(tryUpdate(fallback, samples, sizeof(int16_t), sizeof(int16_t)));
+}
+
+int main() {
+    std::unique_ptr<AudioDevice> device;
+    std::unique_ptr<AudioContext> context;
+    try {
+        device = AudioDevice::createDevice(OpenAL);
+        context = device->createContext();
+        context->makeCurrent();
+    } catch (const std::runtime_error &e) {
+        std::fprintf(stderr, "No audio device: %s\n", e.what());
+        return SKIP_RETURN_CODE;
+    }
+
+    testUpdate(*context);
+    testUpdateAttached(*context);
+    return 0;
+}
@@ -0,0 +1,181 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "dsp/convert.hpp"
+#include "dsp/analysis.hpp"
+
+#include "check.hpp"
+
+#include <vector>
+#include <random>
+#include <algorithm>
+
+using namespace engine;
+
+// Lengths around the vector widths so that the scalar tails of the kernels are covered as well.
+static const size_t COUNTS[] = {0, 1, 3, 4, 7, 8, 15, 16, 17, 31, 33, 1000, 1027};
+
+static std::vector<float> createNoise(size_t count, float amplitude, unsigned int seed) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> distribution(-amplitude, amplitude);
+    std::vector<float> ret(count);
+    for (auto &sample: ret)
+        sample = distribution(random);
+    return ret;
+}
+
+static void testInt16RoundTrip() {
+    std::vector<int16_t> in;
+    for (int value = -32768; value <= 32767; value++)
+        in.emplace_back(static_cast<int16_t>(value));
+
+    std::vector<float> floats(in.size());
+    convertInt16ToFloat(in.data(), floats.data(), in.size());
+    CHECK(floats.front() == -1.0f);
+    CHECK(floats[32768] == 0.0f);
+    CHECK(floats.back() < 1.0f);
+
+    std::vector<int16_t> out(in.size());
+    convertFloatToInt16(floats.data(), out.data(), floats.size());
+    CHECK(out == in);
+}
+
+static void testFloatToInt16() {
+    const float in[] = {2.0f, -2.0f, 1.0f, -1.0f, 0.5f, -0.5f, 0.25f / 32768, 0.75f / 32768, -0.75f / 32768, 0};
+    const int16_t expected[] = {32767, -32768, 32767, -32768, 16384, -16384, 0, 1, -1, 0};
+    const size_t count = sizeof(in) / sizeof(float);
+    int16_t out[count];
+    convertFloatToInt16(in, out, count);
+    for (size_t i = 0; i < count; i++)
+        CHECK(out[i] == expected[i]);
+
+    // In place conversion as used after the analysis.
+    for (auto size: COUNTS) {
+        auto samples = createNoise(size, 1.2f, 1);
+        std::vector<int16_t> reference(size);
+        convertFloatToInt16(samples.data(), reference.data(), size);
+        auto *inPlace = reinterpret_cast<int16_t *>(samples.data());
+        convertFloatToInt16(samples.data(), inPlace, size);
+        CHECK(std::equal(reference.begin(), reference.end(), inPlace));
+    }
+}
+
+static void testApplyGain() {
+    for (auto size: COUNTS) {
+        auto samples = createNoise(size, 1, 2);
+        auto expected = samples;
+        applyGain(samples.data(), size, 0.3f);
+        for (size_t i = 0; i < size; i++)
+            CHECK(samples[i] == expected[i] * 0.3f);
+    }
+}
+
+static void testMixChannels() {
+    const size_t inChannels = 6;
+    const size_t outChannels = 2;
+    std::vector<float> matrix(inChannels * outChannels);
+    for (size_t i = 0; i < matrix.size(); i++)
+        matrix[i] = static_cast<float>(i % 5) * 0.25f;
+
+    for (auto frames: COUNTS) {
+        auto in = createNoise(frames * inChannels, 1, 3);
+        std::vector<float> out(frames * outChannels);
+        mixChannels(in.data(), inChannels, out.data(), outChannels, matrix.data(), frames);
+        for (size_t frame = 0; frame < frames; frame++) {
+            for (size_t o = 0; o < outChannels; o++) {
+                float expected = 0;
+                for (size_t c = 0; c < inChannels; c++)
+                    expected += in[frame * inChannels + c] * matrix[o * inChannels + c];
+                CHECK_NEAR(out[frame * outChannels + o], expected, 1e-5);
+            }
+        }
+    }
+}
+
+static void testInterleave() {
+    for (size_t channels = 1; channels <= 4; channels++) {
+        for (auto frames: COUNTS) {
+            auto in = createNoise(frames * channels, 1, 4);
+            std::vector<std::vector<float>> planes(channels, std::vector<float>(frames));
+            std::vector<float *> pointers;
+            for (auto &plane: planes)
+                pointers.emplace_back(plane.data());
+            deinterleave(in.data(), pointers.data(), channels, frames);
+            for (size_t frame = 0; frame < frames; frame++) {
+                for (size_t c = 0; c < channels; c++)
+                    CHECK(planes[c][frame] == in[frame * channels + c]);
+            }
+
+            std::vector<float> out(frames * channels);
+            interleave(pointers.data(), out.data(), channels, frames);
+            CHECK(out == in);
+        }
+    }
+}
+
+static void testMeasureLevel() {
+    auto empty = measureLevel(nullptr, 0);
+    CHECK(empty.peak == 0 && empty.energy == 0);
+
+    for (auto size: COUNTS) {
+        if (size == 0)
+            continue;
+        auto samples = createNoise(size, 0.8f, 5);
+        auto level = measureLevel(samples.data(), size);
+        float minimum = samples[0];
+        float maximum = samples[0];
+        float peak = 0;
+        double energy = 0;
+        for (auto sample: samples) {
+            minimum = std::min(minimum, sample);
+            maximum = std::max(maximum, sample);
+            peak = std::max(peak, std::abs(sample));
+            energy += static_cast<double>(sample) * sample;
+        }
+        CHECK(level.minimum == minimum);
+        CHECK(level.maximum == maximum);
+        CHECK(level.peak == peak);
+        CHECK_NEAR(level.energy, energy, energy * 1e-5);
+    }
+}
+
+static void testFindFirstAbove() {
+    for (auto size: COUNTS) {
+        auto samples = createNoise(size, 0.1f, 6);
+        CHECK(findFirstAbove(samples.data(), size, 0.5f) == size);
+        for (size_t index = 0; index < size; index += std::max<size_t>(size / 7, 1)) {
+            auto copy = samples;
+            copy[index] = -0.5f;
+            if (index + 1 < size)
+                copy[index + 1] = 0.9f;
+            CHECK(findFirstAbove(copy.data(), size, 0.5f) == index);
+        }
+    }
+}
+
+int main() {
+    testInt16RoundTrip();
+    testFloatToInt16();
+    testApplyGain();
+    testMixChannels();
+    testInterleave();
+    testMeasureLevel();
+    testFindFirstAbove();
+    return 0;
+}
@@ -0,0 +1,109 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "dsp/resampler.hpp"
+
+#include "check.hpp"
+
+#include <vector>
+#include <cmath>
+
+using namespace engine;
+
+static const double PI = 3.14159265358979323846;
+
+/**
+ * Resample a sine tone with zero padding around it as the loader does.
+ */
+static std::vector<float> resampleSine(unsigned int inputRate,
+                                       unsigned int outputRate,
+                                       double frequency,
+                                       size_t frames) {
+    Resampler resampler(inputRate, outputRate);
+    auto padding = resampler.getPadding();
+    std::vector<float> in(frames + padding * 2, 0.0f);
+    for (size_t i = 0; i < frames; i++)
+        in[padding + i] = static_cast<float>(0.5 * std::sin(2 * PI * frequency * i / inputRate));
+
+    std::vector<float> out(resampler.getOutputFrames(frames));
+    resampler.process(in.data() + padding, frames, out.data());
+    return out;
+}
+
+static void testOutputFrames() {
+    CHECK(Resampler(44100, 48000).getOutputFrames(44100) == 48000);
+    CHECK(Resampler(48000, 44100).getOutputFrames(48000) == 44100);
+    CHECK(Resampler(44100, 48000).getOutputFrames(1) == 2);
+    CHECK(Resampler(22050, 44100).getOutputFrames(3) == 6);
+    CHECK(Resampler(44100, 48000).getPadding() % 8 == 0);
+}
+
+static void testSine(unsigned int inputRate, unsigned int outputRate) {
+    const double frequency = 1000;
+    const size_t frames = inputRate / 4;
+    auto out = resampleSine(inputRate, outputRate, frequency, frames);
+
+    // Away from the edges, where the signal starts from silence, the tone passes unchanged.
+    double error = 0;
+    for (size_t n = out.size() / 4; n < out.size() * 3 / 4; n++) {
+        auto expected = 0.5 * std::sin(2 * PI * frequency * n / outputRate);
+        error = std::max(error, std::abs(out[n] - expected));
+    }
+    CHECK(error < 2e-3);
+}
+
+static void testStride() {
+    Resampler resampler(44100, 48000);
+    auto padding = resampler.getPadding();
+    const size_t frames = 1000;
+    std::vector<float> in(frames + padding * 2, 0.0f);
+    for (size_t i = 0; i < frames; i++)
+        in[padding + i] = static_cast<float>(i % 17) / 17;
+
+    auto outputFrames = resampler.getOutputFrames(frames);
+    std::vector<float> plain(outputFrames);
+    resampler.process(in.data() + padding, frames, plain.data());
+    std::vector<float> interleaved(outputFrames * 2, 0.0f);
+    resampler.process(in.data() + padding, frames, interleaved.data() + 1, 2);
+    for (size_t n = 0; n < outputFrames; n++) {
+        CHECK(interleaved[n * 2] == 0.0f);
+        CHECK(interleaved[n * 2 + 1] == plain[n]);
+    }
+}
+
+static void testAntiAliasing() {
+    // A tone above the output Nyquist frequency is removed instead of folding back into the audible range.
+    auto out = resampleSine(48000, 22050, 15000, 12000);
+    double energy = 0;
+    for (size_t n = out.size() / 4; n < out.size() * 3 / 4; n++)
+        energy += static_cast<double>(out[n]) * out[n];
+    auto rms = std::sqrt(energy / static_cast<double>(out.size() / 2));
+    CHECK(rms < 0.5 / std::sqrt(2.0) * 0.01);
+}
+
+int main() {
+    testOutputFrames();
+    testSine(44100, 48000);
+    testSine(48000, 44100);
+    testSine(22050, 48000);
+    testSine(96000, 44100);
+    testStride();
+    testAntiAliasing();
+    return 0;
+}
@@ -0,0 +1,109 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "ringbuffer.hpp"
+
+#include "check.hpp"
+
+#include <thread>
+
+using namespace engine;
+
+static void testCapacity() {
+    RingBuffer<int> ring(3, 7);
+    CHECK(ring.beginRead() == nullptr);
+
+    // The capacity is rounded up to four slots which start with the initial value.
+    for (int i = 0; i < 4; i++) {
+        auto *slot = ring.beginWrite();
+        CHECK(slot != nullptr);
+        CHECK(*slot == 7);
+        *slot = i;
+        ring.commitWrite();
+    }
+    CHECK(ring.isFull());
+    CHECK(ring.beginWrite() == nullptr);
+
+    for (int i = 0; i < 4; i++) {
+        auto *slot = ring.beginRead();
+        CHECK(slot != nullptr);
+        CHECK(*slot == i);
+        ring.commitRead();
+        CHECK(!ring.isFull());
+    }
+    CHECK(ring.beginRead() == nullptr);
+}
+
+static void testWrapAround() {
+    RingBuffer<int> ring(4);
+    int written = 0;
+    int read = 0;
+    for (int round = 0; round < 100; round++) {
+        for (int i = 0; i < round % 5; i++) {
+            auto *slot = ring.beginWrite();
+            if (!slot)
+                break;
+            *slot = written++;
+            ring.commitWrite();
+        }
+        while (auto *slot = ring.beginRead()) {
+            CHECK(*slot == read++);
+            ring.commitRead();
+        }
+    }
+    CHECK(read == written);
+}
+
+static void testProducerConsumer() {
+    const size_t COUNT = 1000000;
+    RingBuffer<size_t> ring(64);
+
+    std::thread producer([&ring]() {
+        for (size_t i = 0; i < COUNT;) {
+            auto *slot = ring.beginWrite();
+            if (!slot) {
+                std::this_thread::yield();
+                continue;
+            }
+            *slot = i++;
+            ring.commitWrite();
+        }
+    });
+
+    size_t expected = 0;
+    while (expected < COUNT) {
+        auto *slot = ring.beginRead();
+        if (!slot) {
+            std::this_thread::yield();
+            continue;
+        }
+        CHECK(*slot == expected);
+        expected++;
+        ring.commitRead();
+    }
+    producer.join();
+    CHECK(ring.beginRead() == nullptr);
+}
+
+int main() {
+    testCapacity();
+    testWrapAround();
+    testProducerConsumer();
+    return 0;
+}
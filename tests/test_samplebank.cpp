@@ -0,0 +1,154 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "samplebank.hpp"
+#include "pcmheader.hpp"
+#include "waveform.hpp"
+
+#include "check.hpp"
+
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+
+#include <dirent.h>
+
+using namespace engine;
+
+static SampleBank::Entry createEntry(const std::string &name, AudioFormat format, size_t frames, float onset) {
+    SampleBank::Entry ret;
+    ret.name = name;
+    ret.audio.format = format;
+    ret.audio.frequency = 48000;
+    ret.audio.data.resize(frames * getChannelCount(format) * getSampleSize(format));
+    for (size_t i = 0; i < ret.audio.data.size(); i++)
+        ret.audio.data[i] = static_cast<uint8_t>(i * 31 + name.size());
+    ret.audio.metadata.onset = onset;
+    ret.audio.metadata.peak = 0.5f;
+    ret.audio.metadata.loudness = -20;
+    ret.audio.metadata.gain = 2;
+    std::vector<Waveform::Bin> blocks((frames + Waveform::BLOCK_FRAMES - 1) / Waveform::BLOCK_FRAMES);
+    for (auto &block: blocks)
+        block.maximum = onset;
+    ret.audio.metadata.waveform = std::make_shared<const Waveform>(std::move(blocks), frames);
+    return ret;
+}
+
+static void testWriteAndRead() {
+    TemporaryDirectory directory;
+    auto path = directory.getPath() + "/kit.bank";
+
+    std::vector<SampleBank::Entry> entries;
+    entries.emplace_back(createEntry("kick", MONO16, 1000, 0.001f));
+    entries.emplace_back(createEntry("hat", STEREO16, 333, 0.002f));
+    entries.emplace_back(createEntry("pad", STEREO_FLOAT32, 5000, 0.003f));
+    SampleBank::write(path, entries);
+
+    SampleBank bank(path);
+    CHECK(bank.getSampleCount() == entries.size());
+    CHECK(bank.find("hat") == 1);
+    CHECK(bank.find("snare") == bank.getSampleCount());
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        auto &expected = entries[i].audio;
+        auto &sample = bank.getSample(i);
+        CHECK(sample.name == entries[i].name);
+        CHECK(sample.format == expected.format);
+        CHECK(sample.frequency == expected.frequency);
+        CHECK(sample.channels == getChannelCount(expected.format));
+        CHECK(sample.frames * sample.channels * getSampleSize(sample.format) == expected.data.size());
+        CHECK(sample.metadata.onset == expected.metadata.onset);
+        CHECK(sample.metadata.loudness == expected.metadata.loudness);
+        CHECK(sample.metadata.gain == expected.metadata.gain);
+        CHECK(!sample.metadata.waveform);
+
+        // The blob is the prepared PCM which the loader uploads from the mapping.
+        CHECK(reinterpret_cast<uintptr_t>(sample.blob) % 4096 == 0);
+        PcmHeader header{};
+        CHECK(PcmHeader::read(sample.blob, sample.blobSize, header));
+        CHECK(header.size == expected.data.size());
+        CHECK(std::memcmp(sample.blob + sizeof(PcmHeader), expected.data.data(), expected.data.size()) == 0);
+
+        auto waveform = bank.getWaveform(i);
+        CHECK(waveform);
+        CHECK(waveform->getFrameCount() == expected.metadata.waveform->getFrameCount());
+        CHECK(waveform->getBins(0, sample.frames, 1).front().maximum == expected.metadata.onset);
+
+        auto kitSample = bank.getKitSample(i);
+        CHECK(kitSample.pcm);
+        CHECK(kitSample.memory == sample.blob);
+        CHECK(kitSample.memorySize == sample.blobSize);
+    }
+}
+
+static void testRewrite() {
+    TemporaryDirectory directory;
+    auto path = directory.getPath() + "/kit.bank";
+
+    std::vector<SampleBank::Entry> entries;
+    entries.emplace_back(createEntry("kick", MONO16, 100000, 0.001f));
+    SampleBank::write(path, entries);
+    SampleBank bank(path);
+    auto &sample = bank.getSample(0);
+
+    // Writing a smaller bank over a mapped one replaces the file, the mapping keeps the previous contents.
+    std::vector<SampleBank::Entry> smaller;
+    smaller.emplace_back(createEntry("hat", MONO16, 10, 0.002f));
+    SampleBank::write(path, smaller);
+    CHECK(std::memcmp(sample.blob + sizeof(PcmHeader),
+                      entries[0].audio.data.data(),
+                      entries[0].audio.data.size()) == 0);
+
+    SampleBank rewritten(path);
+    CHECK(rewritten.getSampleCount() == 1);
+    CHECK(rewritten.getSample(0).name == "hat");
+
+    // No temporary file is left behind.
+    size_t files = 0;
+    auto *dir = opendir(directory.getPath().c_str());
+    CHECK(dir != nullptr);
+    while (auto *ent = readdir(dir)) {
+        if (ent->d_name[0] != '.')
+            files++;
+    }
+    closedir(dir);
+    CHECK(files == 1);
+}
+
+static void testInvalidBank() {
+    TemporaryDirectory directory;
+    auto path = directory.getPath() + "/invalid.bank";
+    std::ofstream(path) << "not a sample bank, but long enough to hold a bank header of sixty four bytes";
+
+    bool thrown = false;
+    try {
+        SampleBank bank(path);
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+int main() {
+    testWriteAndRead();
+    testRewrite();
+    testInvalidBank();
+    return 0;
+}
@@ -0,0 +1,207 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "samplecache.hpp"
+#include "waveform.hpp"
+
+#include "check.hpp"
+
+#include <vector>
+#include <fstream>
+#include <cstring>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+using namespace engine;
+
+static std::vector<int16_t> createData(size_t count, int seed) {
+    std::vector<int16_t> ret(count);
+    for (size_t i = 0; i < count; i++)
+        ret[i] = static_cast<int16_t>((i * 7919 + seed * 104729) % 65536 - 32768);
+    return ret;
+}
+
+static AudioMetadata createMetadata(size_t frames) {
+    AudioMetadata ret;
+    ret.onset = 0.01f;
+    ret.peak = 0.9f;
+    ret.loudness = -18.5f;
+    ret.gain = 1.5f;
+    std::vector<Waveform::Bin> blocks((frames + Waveform::BLOCK_FRAMES - 1) / Waveform::BLOCK_FRAMES);
+    for (size_t i = 0; i < blocks.size(); i++) {
+        blocks[i].minimum = -static_cast<float>(i) / static_cast<float>(blocks.size());
+        blocks[i].maximum = static_cast<float>(i) / static_cast<float>(blocks.size());
+        blocks[i].power = 0.1f;
+    }
+    ret.waveform = std::make_shared<const Waveform>(std::move(blocks), frames);
+    return ret;
+}
+
+static size_t countFiles(const std::string &directory) {
+    size_t ret = 0;
+    DIR *dir = opendir(directory.c_str());
+    if (dir == nullptr)
+        return 0;
+    while (auto *ent = readdir(dir)) {
+        if (ent->d_name[0] != '.' || std::strlen(ent->d_name) > 2)
+            ret++;
+    }
+    closedir(dir);
+    return ret;
+}
+
+static void testHash() {
+    auto data = createData(1000, 1);
+    auto hash = SampleCache::hash(data.data(), data.size() * sizeof(int16_t));
+    CHECK(hash == SampleCache::hash(data.data(), data.size() * sizeof(int16_t)));
+    CHECK(hash != SampleCache::hash(data.data(), data.size() * sizeof(int16_t), 1));
+    CHECK(hash != SampleCache::hash(data.data(), data.size() * sizeof(int16_t) - 1));
+
+    // Every length hits a different combination of the lane and tail loops.
+    for (size_t size = 0; size < 80; size++) {
+        auto copy = data;
+        auto reference = SampleCache::hash(copy.data(), size);
+        if (size > 0) {
+            reinterpret_cast<uint8_t *>(copy.data())[size - 1] ^= 1;
+            CHECK(SampleCache::hash(copy.data(), size) != reference);
+        }
+    }
+}
+
+static void testStoreAndLoad() {
+    TemporaryDirectory directory;
+    SampleCache cache(directory.getPath() + "/cache");
+
+    const size_t frames = 1000;
+    auto data = createData(frames * 2, 2);
+    auto metadata = createMetadata(frames);
+
+    SampleCache::Entry entry;
+    CHECK(!cache.load(42, entry));
+
+    cache.store(42, data.data(), data.size() * sizeof(int16_t), STEREO16, 48000, metadata);
+    CHECK(cache.load(42, entry));
+    CHECK(entry.size == data.size() * sizeof(int16_t));
+    CHECK(std::memcmp(entry.data, data.data(), entry.size) == 0);
+    CHECK(reinterpret_cast<uintptr_t>(entry.data) % 16 == 0);
+    CHECK(entry.format == STEREO16);
+    CHECK(entry.frequency == 48000);
+    CHECK(entry.metadata.onset == metadata.onset);
+    CHECK(entry.metadata.peak == metadata.peak);
+    CHECK(entry.metadata.loudness == metadata.loudness);
+    CHECK(entry.metadata.gain == metadata.gain);
+    CHECK(entry.metadata.waveform);
+    CHECK(entry.metadata.waveform->getFrameCount() == frames);
+    auto expected = metadata.waveform->getBins(0, frames, 7);
+    auto loaded = entry.metadata.waveform->getBins(0, frames, 7);
+    for (size_t i = 0; i < expected.size(); i++)
+        CHECK(loaded[i].maximum == expected[i].maximum);
+
+    // Other keys miss, and no temporary files are left behind.
+    SampleCache::Entry other;
+    CHECK(!cache.load(43, other));
+    CHECK(countFiles(directory.getPath() + "/cache") == 1);
+}
+
+static void testCorruptEntry() {
+    TemporaryDirectory directory;
+    SampleCache cache(directory.getPath());
+    auto data = createData(100, 3);
+    cache.store(1, data.data(), data.size() * sizeof(int16_t), MONO16, 44100, createMetadata(100));
+
+    DIR *dir = opendir(directory.getPath().c_str());
+    std::string name;
+    while (auto *ent = readdir(dir)) {
+        if (ent->d_name[0] != '.')
+            name = ent->d_name;
+    }
+    closedir(dir);
+    CHECK(!name.empty());
+
+    // A truncated entry is rejected and removed.
+    auto path = directory.getPath() + "/" + name;
+    CHECK(truncate(path.c_str(), 100) == 0);
+    SampleCache::Entry entry;
+    CHECK(!cache.load(1, entry));
+    CHECK(countFiles(directory.getPath()) == 0);
+}
+
+static void testEviction() {
+    TemporaryDirectory directory;
+    const size_t entrySize = 64 * 1024;
+    SampleCache cache(directory.getPath(), entrySize * 5 / 2);
+    auto data = createData(entrySize / sizeof(int16_t), 4);
+
+    cache.store(1, data.data(), entrySize, MONO16, 44100, {});
+    cache.store(2, data.data(), entrySize, MONO16, 44100, {});
+
+    // Loading marks an entry as recently used, so the other one is evicted first.
+    struct timeval old[2] = {{1000, 0}, {1000, 0}};
+    DIR *dir = opendir(directory.getPath().c_str());
+    while (auto *ent = readdir(dir)) {
+        if (ent->d_name[0] != '.')
+            utimes((directory.getPath() + "/" + ent->d_name).c_str(), old);
+    }
+    closedir(dir);
+    SampleCache::Entry entry;
+    CHECK(cache.load(1, entry));
+
+    cache.store(3, data.data(), entrySize, MONO16, 44100, {});
+    CHECK(countFiles(directory.getPath()) == 2);
+    SampleCache::Entry first, second, third;
+    CHECK(cache.load(1, first));
+    CHECK(!cache.load(2, second));
+    CHECK(cache.load(3, third));
+
+    // Entries larger than the cache are not stored at all.
+    std::vector<uint8_t> large(entrySize * 3);
+    cache.store(4, large.data(), large.size(), MONO8, 44100, {});
+    SampleCache::Entry fourth;
+    CHECK(!cache.load(4, fourth));
+}
+
+static void testStaleTemporaryFiles() {
+    TemporaryDirectory directory;
+    SampleCache cache(directory.getPath());
+
+    auto stale = directory.getPath() + "/.entry-stale";
+    auto recent = directory.getPath() + "/.entry-recent";
+    std::ofstream(stale) << "interrupted";
+    std::ofstream(recent) << "in progress";
+    struct timeval old[2] = {{1000, 0}, {1000, 0}};
+    CHECK(utimes(stale.c_str(), old) == 0);
+
+    auto data = createData(100, 5);
+    cache.store(1, data.data(), data.size() * sizeof(int16_t), MONO16, 44100, {});
+
+    struct stat st{};
+    CHECK(stat(stale.c_str(), &st) != 0);
+    CHECK(stat(recent.c_str(), &st) == 0);
+}
+
+int main() {
+    testHash();
+    testStoreAndLoad();
+    testCorruptEntry();
+    testEviction();
+    testStaleTemporaryFiles();
+    return 0;
+}
@@ -0,0 +1,108 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "scratcharena.hpp"
+
+#include "check.hpp"
+
+#include <cstring>
+
+using namespace engine;
+
+static bool isAligned(const void *pointer) {
+    return reinterpret_cast<uintptr_t>(pointer) % ScratchArena::ALIGNMENT == 0;
+}
+
+static void testAlignment() {
+    ScratchArena arena;
+    for (size_t size: {1, 3, 17, 63, 64, 65, 1000}) {
+        CHECK(isAligned(arena.allocateBytes(size)));
+        CHECK(isAligned(arena.allocate<int16_t>(size)));
+        CHECK(isAligned(arena.allocate<float>(size)));
+    }
+    // Empty allocations still return distinct memory.
+    CHECK(arena.allocateBytes(0) != arena.allocateBytes(0));
+}
+
+static void testGrowth() {
+    ScratchArena arena;
+    auto *first = arena.allocate<uint8_t>(100);
+    std::memset(first, 0xab, 100);
+
+    // Allocations which do not fit the current block get a new one, earlier allocations stay valid.
+    uint8_t *previous = first;
+    for (size_t size = 128; size <= 1024 * 1024; size *= 2) {
+        auto *block = arena.allocate<uint8_t>(size);
+        CHECK(block != previous);
+        std::memset(block, 0xcd, size);
+        previous = block;
+    }
+    for (size_t i = 0; i < 100; i++)
+        CHECK(first[i] == 0xab);
+    CHECK(arena.capacity() >= 2 * 1024 * 1024);
+}
+
+static void testReuse() {
+    ScratchArena arena;
+    auto load = [&arena]() {
+        arena.allocate<float>(1000);
+        arena.allocate<int16_t>(50000);
+        arena.allocate<float>(200000);
+    };
+
+    load();
+    auto used = arena.capacity();
+    arena.reset();
+
+    // The blocks of the first load are merged, so the same load is served from one block without growing.
+    auto capacity = arena.capacity();
+    CHECK(capacity <= used);
+    for (int i = 0; i < 3; i++) {
+        auto *start = arena.allocateBytes(1);
+        arena.reset();
+        CHECK(arena.allocateBytes(1) == start);
+        arena.reset();
+        load();
+        CHECK(arena.capacity() == capacity);
+        arena.reset();
+    }
+
+    // Loads larger than the retained maximum release their memory.
+    load();
+    arena.reset(1024);
+    CHECK(arena.capacity() == 0);
+    CHECK(isAligned(arena.allocateBytes(10)));
+}
+
+static void testMove() {
+    ScratchArena arena;
+    auto *data = arena.allocate<int>(10);
+    data[9] = 42;
+    ScratchArena moved(std::move(arena));
+    CHECK(data[9] == 42);
+    CHECK(moved.capacity() > 0);
+}
+
+int main() {
+    testAlignment();
+    testGrowth();
+    testReuse();
+    testMove();
+    return 0;
+}
@@ -0,0 +1,113 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "threadpool.hpp"
+
+#include "check.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+using namespace engine;
+
+/**
+ * Counts finished jobs and lets the test wait until all of them ran.
+ */
+class Completion {
+public:
+    void done() {
+        std::lock_guard<std::mutex> guard(mutex);
+        count++;
+        condition.notify_all();
+    }
+
+    void wait(size_t expected) {
+        std::unique_lock<std::mutex> guard(mutex);
+        condition.wait(guard, [&]() { return count >= expected; });
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable condition;
+    size_t count = 0;
+};
+
+static void testJobs() {
+    const size_t JOBS = 100000;
+    ThreadPool pool(4);
+    CHECK(pool.getThreadCount() == 4);
+
+    std::atomic<size_t> sum{0};
+    Completion completion;
+    for (size_t i = 0; i < JOBS; i++) {
+        pool.submit([&sum, &completion, i]() {
+            sum += i;
+            completion.done();
+        });
+    }
+    completion.wait(JOBS);
+    CHECK(sum == JOBS * (JOBS - 1) / 2);
+}
+
+static void testNestedSubmit() {
+    const size_t JOBS = 1000;
+    ThreadPool pool(3);
+    std::atomic<size_t> nested{0};
+    Completion completion;
+    for (size_t i = 0; i < JOBS; i++) {
+        pool.submit([&]() {
+            pool.submit([&]() {
+                nested++;
+                completion.done();
+            });
+            completion.done();
+        });
+    }
+    completion.wait(JOBS * 2);
+    CHECK(nested == JOBS);
+}
+
+static void testIdleWakeUp() {
+    // Workers which went to sleep on an empty pool have to wake up for later submissions.
+    ThreadPool pool(2);
+    for (int round = 0; round < 200; round++) {
+        Completion completion;
+        pool.submit([&completion]() { completion.done(); });
+        completion.wait(1);
+    }
+}
+
+static void testDestructionRunsQueuedJobs() {
+    std::atomic<size_t> count{0};
+    {
+        ThreadPool pool(2);
+        for (int i = 0; i < 1000; i++)
+            pool.submit([&count]() { count++; });
+    }
+    CHECK(count == 1000);
+}
+
+int main() {
+    testJobs();
+    testNestedSubmit();
+    testIdleWakeUp();
+    testDestructionRunsQueuedJobs();
+    return 0;
+}
@@ -0,0 +1,145 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "waveform.hpp"
+
+#include "check.hpp"
+
+#include <vector>
+#include <algorithm>
+
+using namespace engine;
+
+/**
+ * A waveform of mono frames summarized the way the loader builds the blocks.
+ */
+static Waveform createWaveform(const std::vector<float> &samples) {
+    std::vector<Waveform::Bin> blocks;
+    for (size_t start = 0; start < samples.size(); start += Waveform::BLOCK_FRAMES) {
+        auto end = std::min(start + Waveform::BLOCK_FRAMES, samples.size());
+        Waveform::Bin bin;
+        bin.minimum = *std::min_element(samples.begin() + start, samples.begin() + end);
+        bin.maximum = *std::max_element(samples.begin() + start, samples.begin() + end);
+        double energy = 0;
+        for (auto i = start; i < end; i++)
+            energy += static_cast<double>(samples[i]) * samples[i];
+        bin.power = static_cast<float>(energy / static_cast<double>(end - start));
+        blocks.emplace_back(bin);
+    }
+    return Waveform(std::move(blocks), samples.size());
+}
+
+static std::vector<float> createRamp(size_t frames) {
+    std::vector<float> ret(frames);
+    for (size_t i = 0; i < frames; i++)
+        ret[i] = (i % 2 == 0 ? 1.0f : -1.0f) * static_cast<float>(i) / static_cast<float>(frames);
+    return ret;
+}
+
+static void testBins() {
+    const size_t frames = Waveform::BLOCK_FRAMES * 100;
+    auto samples = createRamp(frames);
+    auto waveform = createWaveform(samples);
+    CHECK(waveform.getFrameCount() == frames);
+
+    auto whole = waveform.getBins(0, frames, 1);
+    CHECK(whole.size() == 1);
+    CHECK(whole[0].minimum == *std::min_element(samples.begin(), samples.end()));
+    CHECK(whole[0].maximum == *std::max_element(samples.begin(), samples.end()));
+
+    // Bins of any zoom level agree with the samples they cover.
+    for (size_t count: {1, 3, 10, 100, 1000}) {
+        auto bins = waveform.getBins(0, frames, count);
+        CHECK(bins.size() == count);
+        float maximum = 0;
+        for (auto &bin: bins) {
+            CHECK(bin.minimum <= bin.maximum);
+            maximum = std::max(maximum, bin.maximum);
+        }
+        CHECK(maximum == whole[0].maximum);
+    }
+
+    auto block = waveform.getBins(Waveform::BLOCK_FRAMES * 10, Waveform::BLOCK_FRAMES * 11, 1).front();
+    CHECK(block.minimum == *std::min_element(samples.begin() + Waveform::BLOCK_FRAMES * 10,
+                                             samples.begin() + Waveform::BLOCK_FRAMES * 11));
+
+    // Ranges beyond the end are clamped and empty ranges return silent bins.
+    CHECK(waveform.getBins(frames, frames * 2, 4).front().maximum == 0);
+    CHECK(waveform.getBins(0, frames * 2, 1).front().maximum == whole[0].maximum);
+}
+
+static void testScaleAndTrim() {
+    const size_t frames = Waveform::BLOCK_FRAMES * 8;
+    auto waveform = createWaveform(createRamp(frames));
+    auto before = waveform.getBins(0, frames, 1).front();
+    waveform.scale(0.5f);
+    auto after = waveform.getBins(0, frames, 1).front();
+    CHECK(after.maximum == before.maximum * 0.5f);
+    CHECK(after.minimum == before.minimum * 0.5f);
+    CHECK_NEAR(after.power, before.power * 0.25f, 1e-6);
+
+    waveform.trim(Waveform::BLOCK_FRAMES * 2);
+    CHECK(waveform.getFrameCount() == frames - Waveform::BLOCK_FRAMES * 2);
+    auto trimmed = waveform.getBins(0, Waveform::BLOCK_FRAMES, 1).front();
+    auto reference = createWaveform(createRamp(frames));
+    reference.scale(0.5f);
+    auto expected = reference.getBins(Waveform::BLOCK_FRAMES * 2, Waveform::BLOCK_FRAMES * 3, 1).front();
+    CHECK(trimmed.maximum == expected.maximum);
+
+    waveform.trim(frames * 2);
+    CHECK(waveform.getFrameCount() == 0);
+}
+
+static void testSerialize() {
+    const size_t frames = Waveform::BLOCK_FRAMES * 37 + 5;
+    auto waveform = createWaveform(createRamp(frames));
+    waveform.trim(100);
+    auto data = waveform.serialize();
+
+    Waveform restored;
+    CHECK(Waveform::deserialize(data.data(), data.size(), restored));
+    CHECK(restored.getFrameCount() == waveform.getFrameCount());
+    auto a = waveform.getBins(0, frames, 50);
+    auto b = restored.getBins(0, frames, 50);
+    for (size_t i = 0; i < a.size(); i++) {
+        CHECK(a[i].minimum == b[i].minimum);
+        CHECK(a[i].maximum == b[i].maximum);
+        CHECK(a[i].power == b[i].power);
+    }
+
+    // Truncated and inconsistent data is rejected.
+    Waveform invalid;
+    CHECK(!Waveform::deserialize(data.data(), data.size() - 1, invalid));
+    CHECK(!Waveform::deserialize(data.data(), 8, invalid));
+    auto corrupted = data;
+    corrupted[0] ^= 0xff;
+    CHECK(!Waveform::deserialize(corrupted.data(), corrupted.size(), invalid));
+
+    Waveform empty;
+    auto emptyData = empty.serialize();
+    CHECK(Waveform::deserialize(emptyData.data(), emptyData.size(), invalid));
+    CHECK(invalid.getFrameCount() == 0);
+}
+
+int main() {
+    testBins();
+    testScaleAndTrim();
+    testSerialize();
+    return 0;
+}
@@ -0,0 +1,119 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * Packs the samples in a directory into a sample bank, the samples are named by their path relative to the directory.
+ *
+ * Usage: samplebank [-f frequency] [-l loudness] directory output
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "samplebank.hpp"
+
+static void printUsage() {
+    std::cerr << "Usage: samplebank [-f frequency] [-l loudness] directory output" << std::endl;
+}
+
+static void listFiles(const std::string &directory, const std::string &prefix, std::vector<std::string> &files) {
+    DIR *dir = opendir(directory.c_str());
+    if (dir == nullptr)
+        throw std::runtime_error("Failed to open directory " + directory);
+    std::vector<std::string> names;
+    while (auto *ent = readdir(dir)) {
+        std::string name = ent->d_name;
+        if (name.empty() || name[0] == '.')
+            continue;
+        names.emplace_back(name);
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+
+    for (auto &name: names) {
+        auto path = directory + "/" + name;
+        struct stat st{};
+        if (stat(path.c_str(), &st) != 0)
+            continue;
+        if (S_ISDIR(st.st_mode))
+            listFiles(path, prefix + name + "/", files);
+        else if (S_ISREG(st.st_mode))
+            files.emplace_back(prefix + name);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    unsigned int frequency = 48000;
+
+    engine::AudioLoadOptions options;
+    options.resample = true;
+    options.normalize = true;
+
+    std::string directory;
+    std::string output;
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "-f" && i + 1 < argc) {
+                frequency = static_cast<unsigned int>(std::stoul(argv[++i]));
+            } else if (arg == "-l" && i + 1 < argc) {
+                options.targetLoudness = std::stof(argv[++i]);
+            } else if (directory.empty()) {
+                directory = arg;
+            } else if (output.empty()) {
+                output = arg;
+            } else {
+                printUsage();
+                return 1;
+            }
+        }
+        if (directory.empty() || output.empty()) {
+            printUsage();
+            return 1;
+        }
+
+        std::vector<std::string> files;
+        listFiles(directory, "", files);
+
+        std::vector<engine::SampleBank::Entry> entries;
+        for (auto &file: files) {
+            try {
+                entries.emplace_back(engine::SampleBank::Entry{file,
+                                                               engine::decodeAudioFile(directory + "/" + file,
+                                                                                       frequency,
+                                                                                       options)});
+            } catch (const std::exception &e) {
+                std::cerr << "samplebank: Skipping " << file << ": " << e.what() << std::endl;
+            }
+        }
+
+        engine::SampleBank::write(output, entries);
+        std::cout << "Packed " << entries.size() << " samples into " << output << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << "samplebank: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+/**
+ *  Metronome - A Desktop Metronome application
+ *  Copyright (C) 2021  Julian Zampiccoli
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * Converts a sample into normalized PCM with a PcmHeader, which the application embeds and uploads without decoding.
+ *
+ * Usage: sampleconvert [-f frequency] [-l loudness] input output
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <stdexcept>
+
+#include "audioloader.hpp"
+#include "pcmheader.hpp"
+
+static void printUsage() {
+    std::cerr << "Usage: sampleconvert [-f frequency] [-l loudness] input output" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned int frequency = 48000;
+
+    engine::AudioLoadOptions options;
+    options.resample = true;
+    options.normalize = true;
+
+    std::string input;
+    std::string output;
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "-f" && i + 1 < argc) {
+                frequency = static_cast<unsigned int>(std::stoul(argv[++i]));
+            } else if (arg == "-l" && i + 1 < argc) {
+                options.targetLoudness = std::stof(argv[++i]);
+            } else if (input.empty()) {
+                input = arg;
+            } else if (output.empty()) {
+                output = arg;
+            } else {
+                printUsage();
+                return 1;
+            }
+        }
+        if (input.empty() || output.empty()) {
+            printUsage();
+            return 1;
+        }
+
+        auto audio = engine::decodeAudioFile(input, frequency, options);
+        std::vector<uint8_t> waveform;
+        if (audio.metadata.waveform)
+            waveform = audio.metadata.waveform->serialize();
+        auto header = engine::PcmHeader::create(audio.format,
+                                                audio.frequency,
+                                                audio.data.size(),
+                                                audio.metadata,
+                                                waveform.size());
+
+        std::ofstream stream(output, std::ios::binary | std::ios::trunc);
+        stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        stream.write(reinterpret_cast<const char *>(audio.data.data()), static_cast<std::streamsize>(audio.data.size()));
+        stream.write(reinterpret_cast<const char *>(waveform.data()), static_cast<std::streamsize>(waveform.size()));
+        if (!stream)
+            throw std::runtime_error("Failed to write " + output);
+    } catch (const std::exception &e) {
+        std::cerr << "sampleconvert: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}